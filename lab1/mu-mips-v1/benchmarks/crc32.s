@@ -0,0 +1,98 @@
+# crc32 -- table-driven CRC-32 (IEEE 802.3) over a 256 KiB buffer
+#
+# Builds the 256-entry table bit by bit, fills the buffer with
+# pseudo-random words and runs the byte-wise table update over it in
+# little-endian byte order. The final CRC is left in $s7.
+
+	li $sp, 0x7ffffff0
+	li $s6, 2463534242		# xorshift32 seed
+	li $s0, 0x10010000		# table
+	li $s1, 0x10020000		# buffer
+	li $s2, 65536			# buffer size in words
+	li $s3, 0xedb88320		# reflected polynomial
+
+	move $t1, $zero			# n
+	move $t2, $s0
+table:
+	move $t3, $t1			# c = n
+	li $t4, 8
+table_bit:
+	andi $t5, $t3, 1
+	srl $t3, $t3, 1
+	beq $t5, $zero, table_next
+	xor $t3, $t3, $s3
+table_next:
+	addiu $t4, $t4, -1
+	bgtz $t4, table_bit
+	sw $t3, 0($t2)
+	addiu $t2, $t2, 4
+	addiu $t1, $t1, 1
+	slti $t0, $t1, 256
+	bne $t0, $zero, table
+
+	move $t1, $s1
+	move $t2, $s2
+fill:
+	jal rand
+	sw $v0, 0($t1)
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, fill
+
+	li $s7, 0xffffffff		# crc
+	move $t1, $s1
+	move $t2, $s2
+crc_word:
+	lw $t3, 0($t1)
+	li $t4, 4
+crc_byte:
+	xor $t5, $s7, $t3
+	andi $t5, $t5, 0xff
+	sll $t5, $t5, 2
+	addu $t5, $s0, $t5
+	lw $t5, 0($t5)
+	srl $s7, $s7, 8
+	xor $s7, $s7, $t5
+	srl $t3, $t3, 8
+	addiu $t4, $t4, -1
+	bgtz $t4, crc_byte
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, crc_word
+	nor $s7, $s7, $zero
+	move $s5, $zero
+	j finish
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "crc32 checksum: "
+expected:	.word 0x678edf3a
@@ -0,0 +1,203 @@
+# dhry -- Dhrystone-style integer mix
+#
+# Each of 20000 iterations does the things Dhrystone measures: a string
+# copy and compare, a short counted loop with a leaf call, one- and
+# two-dimensional array updates, a record copy, and MULT/DIVU arithmetic.
+# Loop-carried values and the final arrays and record are folded into a
+# rotate-xor checksum in $s7.
+
+	li $sp, 0x7ffffff0
+	li $s0, 0x10010000		# globals: str1, str2, arr1
+	li $s1, 0x10010200		# arr2[50][50]
+	li $s2, 0x10013000		# rec_a, rec_b (8 words each)
+	li $s3, 20000			# iterations
+
+	addiu $a0, $s0, 0		# str1 = "DHRYSTONE PROGRAM, 1'ST STRING"
+	la $a1, str1_init
+	jal strcpy
+
+	move $s7, $zero
+	move $s5, $zero
+	li $s4, 1			# i
+iter:
+	andi $t0, $s4, 3
+	addiu $a2, $t0, 2		# int1 = 2 + (i & 3)
+	andi $t0, $s4, 7
+	addiu $a3, $t0, 3		# int2 = 3 + (i & 7)
+	li $t7, 7			# int3
+
+	addiu $a0, $s0, 32		# strcpy(str2, "DHRYSTONE PROGRAM, 2'ND STRING")
+	la $a1, str2_init
+	jal strcpy
+	addiu $a0, $s0, 0
+	addiu $a1, $s0, 32
+	jal strgt
+	move $t6, $v0			# b = str1 > str2
+
+counted:
+	slt $t0, $a2, $a3
+	beq $t0, $zero, counted_done
+	li $t1, 5			# int3 = 5 * int1 - int2 (dead, as in Dhrystone)
+	mult $a2, $t1
+	mflo $t7
+	subu $t7, $t7, $a3
+	jal proc7			# int3 = int1 + 2 + int2
+	addiu $a2, $a2, 1
+	j counted
+counted_done:
+
+	addiu $t0, $a2, 5		# proc8: loc = int1 + 5
+	sll $t1, $t0, 2
+	addiu $t2, $s0, 64
+	addu $t2, $t2, $t1		# &arr1[loc]
+	sw $t7, 0($t2)
+	sw $t7, 4($t2)
+	sw $t0, 120($t2)		# arr1[loc + 30] = loc
+	li $t3, 200
+	mult $t0, $t3
+	mflo $t3
+	addu $t3, $s1, $t3
+	addu $t3, $t3, $t1		# &arr2[loc][loc]
+	sw $t0, 0($t3)
+	sw $t0, 4($t3)
+	lw $t4, -4($t3)
+	addiu $t4, $t4, 1
+	sw $t4, -4($t3)
+	lw $t4, 0($t2)
+	sw $t4, 4000($t3)		# arr2[loc + 20][loc] = arr1[loc]
+
+	move $t1, $s2			# proc1: rec_b = rec_a
+	li $t2, 8
+rec_copy:
+	lw $t3, 0($t1)
+	sw $t3, 32($t1)
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, rec_copy
+	andi $t3, $s4, 15
+	addiu $t3, $t3, 5
+	sw $t3, 40($s2)			# rec_b.int_comp = 5 + (i & 15)
+	sw $t3, 44($s2)
+	lw $t4, 8($s2)
+	lw $t5, 44($s2)
+	addu $t4, $t4, $t5
+	sw $t4, 8($s2)			# rec_a.int_comp += rec_b.int_comp
+
+	li $t1, 26			# ch = 'A' + i % 26
+	divu $s4, $t1
+	mfhi $t1
+	addiu $t1, $t1, 65
+
+	mult $a3, $a2			# int2 = int2 * int1
+	mflo $a3
+	divu $a3, $t7			# int1 = int2 / int3
+	mflo $a2
+	subu $t2, $a3, $t7		# int2 = 7 * (int2 - int3) - int1
+	li $t3, 7
+	mult $t2, $t3
+	mflo $a3
+	subu $a3, $a3, $a2
+
+	addu $t6, $t6, $t1
+	move $a0, $a2
+	jal fold
+	move $a0, $a3
+	jal fold
+	move $a0, $t7
+	jal fold
+	move $a0, $t6
+	jal fold
+
+	addiu $s4, $s4, 1
+	slt $t0, $s3, $s4
+	beq $t0, $zero, iter
+
+	addiu $t1, $s0, 64		# fold arr1, arr2 and rec_a.int_comp
+	li $t2, 2612
+tail_fold:
+	lw $a0, 0($t1)
+	jal fold
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, tail_fold
+	lw $a0, 8($s2)
+	jal fold
+	j finish
+
+# strcpy($a0 = dst, $a1 = src), word at a time up to the word holding NUL
+strcpy:
+	lw $t0, 0($a1)
+	sw $t0, 0($a0)
+	addiu $a0, $a0, 4
+	addiu $a1, $a1, 4
+	srl $t0, $t0, 24
+	bne $t0, $zero, strcpy
+	jr $ra
+
+# strgt($a0, $a1): $v0 = 1 if the first differing word of $a0 is greater
+strgt:
+	lw $t0, 0($a0)
+	lw $t1, 0($a1)
+	bne $t0, $t1, strgt_diff
+	srl $t0, $t0, 24
+	beq $t0, $zero, strgt_eq
+	addiu $a0, $a0, 4
+	addiu $a1, $a1, 4
+	j strgt
+strgt_diff:
+	slt $v0, $t1, $t0
+	jr $ra
+strgt_eq:
+	move $v0, $zero
+	jr $ra
+
+# proc7: int3 = int1 + 2 + int2
+proc7:
+	addiu $t7, $a2, 2
+	addu $t7, $t7, $a3
+	jr $ra
+
+# fold $a0 into the checksum in $s7
+fold:
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $a0
+	jr $ra
+
+str1_init:	.asciiz "DHRYSTONE PROGRAM, 1'ST STRING"
+str2_init:	.asciiz "DHRYSTONE PROGRAM, 2'ND STRING"
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "dhry checksum: "
+expected:	.word 0x93ec4264
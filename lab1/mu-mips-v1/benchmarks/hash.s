@@ -0,0 +1,138 @@
+# hash -- open-addressing hash table build and probe
+#
+# Inserts 12000 pseudo-random keys into a 16384-slot table from sbrk
+# (multiplicative hash, linear probing), then looks up the same keys and
+# 12000 fresh ones. The table contents, hit counts and total probe count
+# are folded into a rotate-xor checksum in $s7; $s5 is non-zero if a
+# stored key could not be found again.
+
+	li $sp, 0x7ffffff0
+	li $s1, 12000			# keys per phase
+	li $s3, 0x9e3779b1		# hash multiplier
+
+	li $a0, 65536
+	li $v0, 9			# sbrk(16384 * 4)
+	syscall
+	move $s0, $v0			# table
+
+	li $s6, 2463534242		# xorshift32 seed
+	move $s2, $zero			# duplicates
+	move $s4, $zero			# probes
+	move $t1, $s1
+insert:
+	jal rand
+	ori $a0, $v0, 1			# zero marks an empty slot
+	jal find
+	beq $v0, $zero, insert_new
+	addiu $s2, $s2, 1
+	j insert_next
+insert_new:
+	sw $a0, 0($v1)			# find leaves the empty slot in $v1
+insert_next:
+	addiu $t1, $t1, -1
+	bgtz $t1, insert
+
+	li $s6, 2463534242		# replay the inserted keys
+	move $t2, $zero			# hits
+	move $t1, $s1
+lookup:
+	jal rand
+	ori $a0, $v0, 1
+	jal find
+	addu $t2, $t2, $v0
+	addiu $t1, $t1, -1
+	bgtz $t1, lookup
+
+	move $t3, $zero			# hits among fresh keys
+	move $t1, $s1
+miss:
+	jal rand
+	ori $a0, $v0, 1
+	jal find
+	addu $t3, $t3, $v0
+	addiu $t1, $t1, -1
+	bgtz $t1, miss
+
+	move $s7, $zero
+	move $t4, $s0
+	li $t5, 16384
+fold:
+	lw $t6, 0($t4)
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t6
+	addiu $t4, $t4, 4
+	addiu $t5, $t5, -1
+	bgtz $t5, fold
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t2
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t3
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $s4
+
+	subu $s5, $s1, $t2		# every replayed key must hit
+	j finish
+
+# find($a0 = key): $v0 = 1 if present, else 0 with $v1 = empty slot address
+find:
+	mult $a0, $s3
+	mflo $t6
+	srl $t6, $t6, 18
+find_probe:
+	addiu $s4, $s4, 1
+	sll $t7, $t6, 2
+	addu $v1, $s0, $t7
+	lw $t7, 0($v1)
+	beq $t7, $zero, find_empty
+	beq $t7, $a0, find_hit
+	addiu $t6, $t6, 1
+	andi $t6, $t6, 0x3fff
+	j find_probe
+find_hit:
+	li $v0, 1
+	jr $ra
+find_empty:
+	move $v0, $zero
+	jr $ra
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "hash checksum: "
+expected:	.word 0x225bdf92
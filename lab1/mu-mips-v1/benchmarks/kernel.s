@@ -0,0 +1,73 @@
+# kernel -- minimal kernel for running the benchmarks under the TLB (-m -k)
+#
+# Assemble at 0x80000000; the simulator loads it at the refill vector. The
+# boot code builds an identity page table at 0x80200000 for the pages the
+# benchmarks use (text, data and heap, top of the stack), points Context at
+# it and drops to the program at 0x00400000 with ERET. Misses on any other
+# user page add its identity entry on first touch. The TLB refill handler
+# loads the entry Context points at; with walk=hw the hardware does that and
+# only first touches reach the general handler. Any other exception ends the
+# run with exit2 status 100 + the exception code.
+
+	.org 0x80000000
+refill:
+	mfc0 $k0, 4			# Context: address of the PTE
+	lw $k1, 0($k0)
+	beq $k1, $zero, touch
+load:
+	mtc0 $k1, 2			# EntryLo
+	tlbwr
+	eret
+touch:
+	mfc0 $k1, 8			# BadVAddr
+	srl $k1, $k1, 12
+	sll $k1, $k1, 12
+	ori $k1, $k1, 0x600		# identity PFN, D | V
+	sw $k1, 0($k0)
+	b load
+
+	.org 0x80000080
+general:
+	mfc0 $k0, 13			# Cause
+	andi $k0, $k0, 0x7c
+	addiu $k1, $zero, 8		# TLBL
+	beq $k0, $k1, refill
+	addiu $k1, $zero, 12		# TLBS
+	beq $k0, $k1, refill
+	srl $a0, $k0, 2
+	addiu $a0, $a0, 100
+	addiu $v0, $zero, 17
+	syscall
+
+	.org 0x80000200
+boot:
+	li $k0, 0x80200000		# page table, 2 MiB aligned
+	mtc0 $k0, 4
+	li $a0, 0x00400000		# text
+	li $a1, 0x00500000
+	jal map
+	li $a0, 0x10000000		# data and the sbrk heap
+	li $a1, 0x10400000
+	jal map
+	li $a0, 0x7ff00000		# stack
+	li $a1, 0x80000000
+	jal map
+	li $k0, 0x00400000
+	mtc0 $k0, 14			# EPC
+	move $a0, $zero
+	move $a1, $zero
+	move $t0, $zero
+	move $t1, $zero
+	move $ra, $zero
+	move $k0, $zero
+	eret
+
+# identity entries for the pages in [$a0, $a1)
+map:
+	srl $t0, $a0, 10		# VPN * 4
+	addu $t0, $t0, $k0
+	ori $t1, $a0, 0x600		# D | V
+	sw $t1, 0($t0)
+	addiu $a0, $a0, 4096
+	bne $a0, $a1, map
+	jr $ra
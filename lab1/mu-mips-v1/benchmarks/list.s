@@ -0,0 +1,131 @@
+# list -- pointer chasing over a shuffled 16384-node linked list
+#
+# Nodes ({next, value}, 8 bytes) and a permutation array come from sbrk.
+# The permutation is a Fisher-Yates shuffle (DIVU for the modulo) and the
+# list is linked in permutation order, so traversal jumps around the heap.
+# Each of 32 passes sums the values; the sums go into a rotate-xor
+# checksum in $s7 and $s5 counts passes that did not visit every node.
+
+	li $sp, 0x7ffffff0
+	li $s6, 2463534242		# xorshift32 seed
+	li $s1, 16384			# number of nodes
+
+	sll $a0, $s1, 3
+	li $v0, 9			# sbrk(n * 8)
+	syscall
+	move $s0, $v0			# nodes
+	sll $a0, $s1, 2
+	li $v0, 9			# sbrk(n * 4)
+	syscall
+	move $s2, $v0			# perm
+
+	move $t1, $zero			# perm[i] = i, node[i].value = rand & 0xffff
+	move $t2, $s2
+	move $t3, $s0
+init:
+	sw $t1, 0($t2)
+	jal rand
+	andi $v0, $v0, 0xffff
+	sw $v0, 4($t3)
+	addiu $t1, $t1, 1
+	addiu $t2, $t2, 4
+	addiu $t3, $t3, 8
+	bne $t1, $s1, init
+
+	addiu $t1, $s1, -1		# k = n - 1
+shuffle:
+	jal rand
+	addiu $t2, $t1, 1
+	divu $v0, $t2
+	mfhi $t2			# j = rand % (k + 1)
+	sll $t3, $t1, 2
+	addu $t3, $s2, $t3
+	sll $t4, $t2, 2
+	addu $t4, $s2, $t4
+	lw $t5, 0($t3)
+	lw $t6, 0($t4)
+	sw $t6, 0($t3)
+	sw $t5, 0($t4)
+	addiu $t1, $t1, -1
+	bgtz $t1, shuffle
+
+	move $t1, $s2			# node[perm[k]].next = &node[perm[k + 1]]
+	addiu $t2, $s1, -1
+link:
+	lw $t3, 0($t1)
+	sll $t3, $t3, 3
+	addu $t3, $s0, $t3
+	lw $t4, 4($t1)
+	sll $t4, $t4, 3
+	addu $t4, $s0, $t4
+	sw $t4, 0($t3)
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, link
+	lw $t3, 0($t1)
+	sll $t3, $t3, 3
+	addu $t3, $s0, $t3
+	sw $zero, 0($t3)		# tail
+
+	lw $s3, 0($s2)			# head = &node[perm[0]]
+	sll $s3, $s3, 3
+	addu $s3, $s0, $s3
+
+	move $s7, $zero
+	move $s5, $zero
+	li $s4, 32			# passes
+pass:
+	move $t1, $s3
+	move $t2, $zero			# sum
+	move $t3, $zero			# nodes visited
+walk:
+	lw $t4, 4($t1)
+	lw $t1, 0($t1)
+	addu $t2, $t2, $t4
+	addiu $t3, $t3, 1
+	bne $t1, $zero, walk
+	addu $t2, $t2, $s4
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t2
+	beq $t3, $s1, pass_ok
+	addiu $s5, $s5, 1
+pass_ok:
+	addiu $s4, $s4, -1
+	bgtz $s4, pass
+	j finish
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "list checksum: "
+expected:	.word 0xc23e3dd9
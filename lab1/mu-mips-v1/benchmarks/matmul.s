@@ -0,0 +1,101 @@
+# matmul -- 64x64 integer matrix multiply, C = A * B
+#
+# A and B are filled with pseudo-random bytes so every dot product fits
+# in 32 bits. The inner loop is MULT/MFLO plus a strided walk down a
+# column of B. C is folded row-major into a rotate-xor checksum in $s7.
+
+	li $sp, 0x7ffffff0
+	li $s6, 2463534242		# xorshift32 seed
+	li $s0, 0x10010000		# A
+	li $s1, 0x10014000		# B
+	li $s2, 0x10018000		# C
+	li $s3, 64			# n
+
+	move $t1, $s0			# A and B are contiguous, fill both
+	li $t2, 8192
+fill:
+	jal rand
+	andi $v0, $v0, 0xff
+	sw $v0, 0($t1)
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, fill
+
+	move $a0, $s0			# row of A
+	move $a2, $s2			# element of C
+	move $t1, $s3			# i
+mm_row:
+	move $a1, $s1			# column of B
+	move $t2, $s3			# j
+mm_col:
+	move $t4, $a0
+	move $t5, $a1
+	move $t6, $zero			# sum
+	move $t3, $s3			# k
+mm_dot:
+	lw $t7, 0($t4)
+	lw $t8, 0($t5)
+	mult $t7, $t8
+	mflo $t9
+	addu $t6, $t6, $t9
+	addiu $t4, $t4, 4
+	addiu $t5, $t5, 256
+	addiu $t3, $t3, -1
+	bgtz $t3, mm_dot
+	sw $t6, 0($a2)
+	addiu $a2, $a2, 4
+	addiu $a1, $a1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, mm_col
+	addiu $a0, $a0, 256
+	addiu $t1, $t1, -1
+	bgtz $t1, mm_row
+
+	move $s7, $zero			# checksum
+	move $s5, $zero			# no self-check beyond the checksum
+	move $t1, $s2
+	li $t2, 4096
+check:
+	lw $t3, 0($t1)
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t3
+	addiu $t1, $t1, 4
+	addiu $t2, $t2, -1
+	bgtz $t2, check
+	j finish
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "matmul checksum: "
+expected:	.word 0xdf47af3f
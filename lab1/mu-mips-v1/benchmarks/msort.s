@@ -0,0 +1,149 @@
+# msort -- bottom-up merge sort of 20000 pseudo-random words
+#
+# Runs ping-pong between the array at the start of the data segment and
+# a scratch buffer right after it. The sorted result is checked for order
+# ($s5 counts inversions) and folded into a rotate-xor checksum in $s7.
+
+	li $sp, 0x7ffffff0
+	li $s6, 2463534242		# xorshift32 seed
+	li $s0, 0x10010000		# source buffer
+	li $s4, 0x10030000		# destination buffer
+	li $s1, 20000			# number of elements
+
+	move $s2, $s0
+	move $s3, $s1
+	li $t0, 0x7fffffff		# keep keys positive (SLT compares unsigned)
+fill:
+	jal rand
+	and $v0, $v0, $t0
+	sw $v0, 0($s2)
+	addiu $s2, $s2, 4
+	addiu $s3, $s3, -1
+	bgtz $s3, fill
+
+	sll $s2, $s1, 2			# n in bytes
+	li $s3, 4			# run width in bytes
+ms_outer:
+	slt $t0, $s3, $s2
+	beq $t0, $zero, ms_sorted
+	move $t1, $zero			# start of this pair of runs
+ms_pass:
+	slt $t0, $t1, $s2
+	beq $t0, $zero, ms_pass_done
+	addu $t2, $t1, $s3		# mid = min(start + width, n)
+	slt $t0, $s2, $t2
+	beq $t0, $zero, ms_mid_ok
+	move $t2, $s2
+ms_mid_ok:
+	sll $t3, $s3, 1			# end = min(start + 2 * width, n)
+	addu $t3, $t1, $t3
+	slt $t0, $s2, $t3
+	beq $t0, $zero, ms_end_ok
+	move $t3, $s2
+ms_end_ok:
+	move $t4, $t1			# p walks the left run
+	move $t5, $t2			# q walks the right run
+	move $t6, $t1			# k walks the output
+ms_merge:
+	slt $t0, $t4, $t2
+	beq $t0, $zero, ms_tail_q
+	slt $t0, $t5, $t3
+	beq $t0, $zero, ms_tail_p
+	addu $a2, $s0, $t4
+	lw $a2, 0($a2)
+	addu $a3, $s0, $t5
+	lw $a3, 0($a3)
+	addu $t7, $s4, $t6
+	addiu $t6, $t6, 4
+	slt $t0, $a3, $a2
+	bne $t0, $zero, ms_take_q
+	sw $a2, 0($t7)
+	addiu $t4, $t4, 4
+	j ms_merge
+ms_take_q:
+	sw $a3, 0($t7)
+	addiu $t5, $t5, 4
+	j ms_merge
+ms_tail_p:
+	slt $t0, $t4, $t2
+	beq $t0, $zero, ms_run_done
+	addu $a2, $s0, $t4
+	lw $a2, 0($a2)
+	addu $t7, $s4, $t6
+	sw $a2, 0($t7)
+	addiu $t4, $t4, 4
+	addiu $t6, $t6, 4
+	j ms_tail_p
+ms_tail_q:
+	slt $t0, $t5, $t3
+	beq $t0, $zero, ms_run_done
+	addu $a3, $s0, $t5
+	lw $a3, 0($a3)
+	addu $t7, $s4, $t6
+	sw $a3, 0($t7)
+	addiu $t5, $t5, 4
+	addiu $t6, $t6, 4
+	j ms_tail_q
+ms_run_done:
+	move $t1, $t3
+	j ms_pass
+ms_pass_done:
+	move $t0, $s0			# swap source and destination
+	move $s0, $s4
+	move $s4, $t0
+	sll $s3, $s3, 1
+	j ms_outer
+
+ms_sorted:
+	move $s7, $zero			# checksum
+	move $s5, $zero			# inversions
+	move $s2, $s0
+	addiu $s3, $s1, -1
+	lw $t1, 0($s2)
+check:
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t1
+	beq $s3, $zero, finish
+	lw $t2, 4($s2)
+	slt $t0, $t2, $t1
+	addu $s5, $s5, $t0
+	move $t1, $t2
+	addiu $s2, $s2, 4
+	addiu $s3, $s3, -1
+	j check
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "msort checksum: "
+expected:	.word 0xcfe453b0
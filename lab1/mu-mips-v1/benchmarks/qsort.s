@@ -0,0 +1,120 @@
+# qsort -- recursive quicksort (Lomuto partition) of 20000 pseudo-random words
+#
+# The array lives at the start of the data segment. After sorting, the
+# array is checked for order ($s5 counts inversions) and folded into a
+# rotate-xor checksum in $s7. Exits through exit2 with status 0 when the
+# array is sorted and the checksum matches the expected value.
+
+	li $sp, 0x7ffffff0
+	li $s6, 2463534242		# xorshift32 seed
+	li $s0, 0x10010000		# array base
+	li $s1, 20000			# number of elements
+
+	move $s2, $s0
+	move $s3, $s1
+	li $s4, 0x7fffffff		# keep keys positive (SLT compares unsigned)
+fill:
+	jal rand
+	and $v0, $v0, $s4
+	sw $v0, 0($s2)
+	addiu $s2, $s2, 4
+	addiu $s3, $s3, -1
+	bgtz $s3, fill
+
+	move $a0, $s0			# lo = &a[0]
+	sll $t0, $s1, 2
+	addu $a1, $s0, $t0
+	addiu $a1, $a1, -4		# hi = &a[n-1]
+	jal qsort
+
+	move $s7, $zero			# checksum
+	move $s5, $zero			# inversions
+	move $s2, $s0
+	addiu $s3, $s1, -1
+	lw $t1, 0($s2)
+check:
+	sll $t8, $s7, 1
+	srl $t9, $s7, 31
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t1
+	beq $s3, $zero, finish
+	lw $t2, 4($s2)
+	slt $t0, $t2, $t1
+	addu $s5, $s5, $t0
+	move $t1, $t2
+	addiu $s2, $s2, 4
+	addiu $s3, $s3, -1
+	j check
+
+# qsort($a0 = lo pointer, $a1 = hi pointer)
+qsort:
+	slt $t0, $a0, $a1
+	beq $t0, $zero, qs_ret
+	addiu $sp, $sp, -12
+	sw $ra, 0($sp)
+	sw $a1, 4($sp)
+	lw $t1, 0($a1)			# pivot = *hi
+	addiu $t2, $a0, -4		# i = lo - 1
+	move $t3, $a0			# j = lo
+qs_loop:
+	beq $t3, $a1, qs_split
+	lw $t4, 0($t3)
+	slt $t0, $t1, $t4
+	bne $t0, $zero, qs_next
+	addiu $t2, $t2, 4
+	lw $t5, 0($t2)
+	sw $t4, 0($t2)
+	sw $t5, 0($t3)
+qs_next:
+	addiu $t3, $t3, 4
+	j qs_loop
+qs_split:
+	addiu $t2, $t2, 4		# p = i + 1
+	lw $t5, 0($t2)
+	sw $t1, 0($t2)
+	sw $t5, 0($a1)
+	sw $t2, 8($sp)
+	addiu $a1, $t2, -4
+	jal qsort			# qsort(lo, p - 1)
+	lw $t2, 8($sp)
+	addiu $a0, $t2, 4
+	lw $a1, 4($sp)
+	jal qsort			# qsort(p + 1, hi)
+	lw $ra, 0($sp)
+	addiu $sp, $sp, 12
+qs_ret:
+	jr $ra
+
+# rand: advance the xorshift32 state in $s6, result in $v0
+rand:
+	sll $t9, $s6, 13
+	xor $s6, $s6, $t9
+	srl $t9, $s6, 17
+	xor $s6, $s6, $t9
+	sll $t9, $s6, 5
+	xor $s6, $s6, $t9
+	move $v0, $s6
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+name:	.asciiz "qsort checksum: "
+expected:	.word 0xcfe453b0
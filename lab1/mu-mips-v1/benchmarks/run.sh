@@ -0,0 +1,43 @@
+#!/bin/sh
+# Run the benchmark suite and check each result against expected.txt.
+# Usage: ./run.sh [path to mu-mips] [flat|sw|hw]
+#
+# sw and hw run every benchmark under kernel.in with the TLB on (-m -k),
+# refilled by the kernel or by the hardware walker. The kernel's own
+# instructions add to the count, so those modes check only the checksum
+# and the exit status. Programs that name their own kernel in expected.txt
+# run in flat mode only.
+
+SIM=${1:-../src/mu-mips}
+case ${2:-flat} in
+flat)	MMU= ;;
+sw)	MMU="-m default -k kernel.in" ;;
+hw)	MMU="-m walk=hw -k kernel.in" ;;
+*)	echo "usage: $0 [path to mu-mips] [flat|sw|hw]"; exit 1 ;;
+esac
+cd "$(dirname "$0")" || exit 1
+FAILED=0
+
+printf "%-8s %-6s %-12s %10s %8s %8s\n" benchmark result checksum instrs seconds MIPS
+grep -v '^#' expected.txt | while read -r NAME SUM COUNT KERNEL; do
+	OPTS=$MMU
+	if [ -n "$KERNEL" ]; then
+		[ -z "$MMU" ] || continue
+		OPTS="-k $KERNEL.in"
+	fi
+	START=$(date +%s.%N)
+	OUT=$(printf 'sim\nrdump\nq\n' | "$SIM" -q $OPTS "$NAME.in")
+	END=$(date +%s.%N)
+	GOT_SUM=$(echo "$OUT" | awk '/^\[R23\]/ { print $3 }')
+	GOT_COUNT=$(echo "$OUT" | awk '/# Instructions Executed/ { print $NF }')
+	STATUS=$(echo "$OUT" | awk '/Program exited with status/ { print $NF }')
+	RESULT=ok
+	if [ "$STATUS" != 0 ] || [ "$GOT_SUM" != "$SUM" ] || { [ -z "$MMU" ] && [ "$GOT_COUNT" != "$COUNT" ]; }; then
+		RESULT=FAIL
+	fi
+	awk -v n="$NAME" -v r="$RESULT" -v s="$GOT_SUM" -v c="$GOT_COUNT" -v t0="$START" -v t1="$END" \
+		'BEGIN { t = t1 - t0; printf "%-8s %-6s %-12s %10s %8.3f %8.1f\n", n, r, s, c, t, c / t / 1e6 }'
+	[ "$RESULT" = ok ] || exit 1
+done || FAILED=1
+
+exit $FAILED
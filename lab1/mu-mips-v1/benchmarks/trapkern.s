@@ -0,0 +1,82 @@
+# trapkern -- kernel for traps.s: logs exceptions and time-slices two tasks
+#
+# Assemble at 0x80000000 and run with -k trapkern.in (no -m: user
+# addresses are physical). The kernel keeps its state in the first words
+# of the data segment, where the program can check it:
+#
+#	0x10010000	next free log entry
+#	0x10010004	EPC of the task that is not running, 0 while there is one
+#	0x10010008	timer interrupts taken
+#	0x1001000c	scratch for the task switch
+#	0x10010010	log: {Cause, EPC, BadVAddr} per exception
+#
+# Exceptions are logged and resumed after the faulting instruction; a
+# misaligned fetch has no instruction to skip and resumes at $ra. The
+# Count/Compare timer interrupts every 500 instructions and switches tasks
+# once the program has stored a second task's entry point.
+
+	.org 0x80000000
+refill:					# no TLB without -m
+	addiu $a0, $zero, 99
+	addiu $v0, $zero, 17
+	syscall
+
+	.org 0x80000080
+general:
+	lui $k0, 0x1001
+	mfc0 $k1, 13			# Cause
+	andi $k1, $k1, 0x7c
+	beq $k1, $zero, tick
+	lw $k1, 0($k0)
+	mfc0 $k0, 13
+	sw $k0, 0($k1)
+	mfc0 $k0, 14			# EPC
+	sw $k0, 4($k1)
+	mfc0 $k0, 8			# BadVAddr
+	sw $k0, 8($k1)
+	addiu $k1, $k1, 12
+	lui $k0, 0x1001
+	sw $k1, 0($k0)
+	mfc0 $k0, 14
+	andi $k1, $k0, 3
+	beq $k1, $zero, skip
+	move $k0, $ra			# misaligned fetch: back to the caller
+	b resume
+skip:
+	addiu $k0, $k0, 4
+resume:
+	mtc0 $k0, 14
+	eret
+
+tick:
+	lw $k1, 8($k0)
+	addiu $k1, $k1, 1
+	sw $k1, 8($k0)
+	mfc0 $k1, 9			# Compare = Count + 500 acknowledges it
+	addiu $k1, $k1, 500
+	mtc0 $k1, 11
+	lw $k1, 4($k0)
+	beq $k1, $zero, back
+	sw $k1, 12($k0)			# swap EPC with the waiting task
+	mfc0 $k1, 14
+	sw $k1, 4($k0)
+	lw $k1, 12($k0)
+	mtc0 $k1, 14
+back:
+	eret
+
+	.org 0x80000200
+boot:
+	lui $k0, 0x1001
+	addiu $k1, $k0, 16
+	sw $k1, 0($k0)
+	mfc0 $k1, 9
+	addiu $k1, $k1, 500
+	mtc0 $k1, 11
+	li $k1, 0x8003			# IM7 | EXL | IE, ERET clears EXL
+	mtc0 $k1, 12
+	li $k0, 0x00400000
+	mtc0 $k0, 14
+	move $k0, $zero
+	move $k1, $zero
+	eret
@@ -0,0 +1,183 @@
+# traps -- every exception the simulator raises, plus timer-sliced tasks
+#
+# Runs under trapkern.s (-k trapkern.in), which logs each exception's
+# Cause, EPC and BadVAddr and resumes after it. The program raises ADDI,
+# ADD and SUB overflow, DIV by zero, misaligned LW, LH, SW and fetch, and
+# a reserved instruction, checking that none of them changed its target.
+# It then hands the kernel a second task: both count to 20000 and only
+# finish if the Count/Compare timer switches between them. The log is
+# compared with the table at the end ($s5 counts mismatches) and folded
+# with the tick count and both task counters into a checksum in $s7.
+# Exits through exit2 with status 0 when everything matched.
+
+	li $sp, 0x7ffffff0
+	li $s0, 0x10010000		# kernel state, see trapkern.s
+	li $s4, 0x10020000		# scratch data
+	move $s5, $zero
+
+	li $t0, 0x7fffffff
+	li $t1, 5
+ov_addi:
+	addi $t1, $t0, 1
+ov_add:
+	add $t1, $t0, $t0
+	li $t2, 0x80000000
+	addiu $t3, $zero, 1
+ov_sub:
+	sub $t1, $t2, $t3
+	jal keep5
+
+	li $t4, 7
+	mtlo $t4
+	mthi $t4
+div_zero:
+	div $t0, $zero
+	mflo $t1
+	addiu $t1, $t1, -2
+	jal keep5
+	mfhi $t1
+	addiu $t1, $t1, -2
+	jal keep5
+
+ld_word:
+	lw $t1, 2($s4)
+ld_half:
+	lh $t1, 1($s4)
+	jal keep5
+	li $t4, 0x12345678
+st_word:
+	sw $t4, 1($s4)
+	lw $t4, 0($s4)
+	lw $t5, 4($s4)
+	or $t4, $t4, $t5
+	beq $t4, $zero, stored
+	addiu $s5, $s5, 1
+stored:
+reserved:
+	.word 0xfc000000
+	la $ra, fetched
+	la $t4, fetch+2
+	jr $t4
+fetch:
+	addiu $s5, $s5, 1		# never runs
+fetched:
+
+	la $t4, task_b			# from now on the timer switches tasks
+	sw $t4, 4($s0)
+	li $t6, 20000
+task_a:
+	addiu $s1, $s1, 1
+	bne $s1, $t6, task_a
+wait_b:
+	lw $t6, 0x10($s4)
+	beq $t6, $zero, wait_b
+	sw $zero, 4($s0)		# task b is done, stop switching
+	j check
+
+task_b:
+	li $t7, 20000
+count_b:
+	addiu $s2, $s2, 1
+	bne $s2, $t7, count_b
+	addiu $t7, $zero, 1
+	sw $t7, 0x10($s4)
+idle_b:
+	b idle_b
+
+# $t1 must still be 5 after each trapping instruction
+keep5:
+	addiu $t9, $zero, 5
+	beq $t1, $t9, kept
+	addiu $s5, $s5, 1
+kept:
+	li $t1, 5
+	jr $ra
+
+check:
+	move $s7, $zero
+	la $t0, table
+	addiu $t1, $s0, 16		# log
+	la $t2, table_end
+entry:
+	lw $t3, 0($t1)			# Cause
+	andi $t3, $t3, 0x7c
+	lw $t4, 0($t0)
+	beq $t3, $t4, cause_ok
+	addiu $s5, $s5, 1
+cause_ok:
+	jal fold3
+	lw $t3, 4($t1)			# EPC
+	lw $t4, 4($t0)
+	beq $t3, $t4, epc_ok
+	addiu $s5, $s5, 1
+epc_ok:
+	jal fold3
+	lw $t4, 8($t0)			# BadVAddr, 0 where it is not set
+	beq $t4, $zero, next
+	lw $t3, 8($t1)
+	beq $t3, $t4, bad_ok
+	addiu $s5, $s5, 1
+bad_ok:
+	jal fold3
+next:
+	addiu $t0, $t0, 12
+	addiu $t1, $t1, 12
+	bne $t0, $t2, entry
+	lw $t3, 0($s0)			# nothing else was logged
+	beq $t3, $t1, log_ok
+	addiu $s5, $s5, 1
+log_ok:
+	lw $t3, 8($s0)			# ticks
+	bgtz $t3, ticked
+	addiu $s5, $s5, 1
+ticked:
+	jal fold3
+	move $t3, $s1
+	jal fold3
+	move $t3, $s2
+	jal fold3
+	j finish
+
+# $s7 = rotl($s7, 5) ^ $t3
+fold3:
+	sll $t8, $s7, 5
+	srl $t9, $s7, 27
+	or $s7, $t8, $t9
+	xor $s7, $s7, $t3
+	jr $ra
+
+finish:
+	la $a0, name
+	li $v0, 4
+	syscall
+	move $a0, $s7
+	li $v0, 1
+	syscall
+	li $a0, 10
+	li $v0, 11
+	syscall
+	la $t0, expected
+	lw $t0, 0($t0)
+	li $a0, 1
+	bne $s7, $t0, exit
+	bne $s5, $zero, exit
+	move $a0, $zero
+exit:
+	li $v0, 17
+	syscall
+
+# Cause & 0x7c, EPC, BadVAddr for each exception, in order
+table:
+	.word 48, ov_addi, 0
+	.word 48, ov_add, 0
+	.word 48, ov_sub, 0
+	.word 52, div_zero, 0
+	.word 16, ld_word, 0x10020002
+	.word 16, ld_half, 0x10020001
+	.word 20, st_word, 0x10020001
+	.word 40, reserved, 0
+	.word 16, fetch+2, fetch+2
+table_end:
+
+name:	.asciiz "traps checksum: "
+expected:	.word 0xc3f4d6f1
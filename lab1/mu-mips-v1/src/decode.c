@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "decode.h"
+#include "isa.h"
+
+/***************************************************************/
+/* Resolve an OPND_* selector from isa.def to a register       */
+/***************************************************************/
+static uint8_t operand_reg(int operand, uint32_t instruction) {
+	switch (operand) {
+	case OPND_RS:
+		return (instruction >> 21) & 0x1F;
+	case OPND_RT:
+		return (instruction >> 16) & 0x1F;
+	case OPND_RD:
+		return (instruction >> 11) & 0x1F;
+	case OPND_HI:
+		return REG_HI;
+	case OPND_LO:
+		return REG_LO;
+	case OPND_V0:
+		return 2;
+	case OPND_A0:
+		return 4;
+	case OPND_RA:
+		return 31;
+	}
+	return REG_NONE;
+}
+
+/***************************************************************/
+/* Fill in the registers an instruction reads and writes, as   */
+/* listed for it in isa.def                                    */
+/***************************************************************/
+void decode_deps(uint32_t instruction, inst_deps_t *deps) {
+	const isa_info_t *info = &ISA_INFO[isa_decode(instruction)];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		deps->src[i] = operand_reg(info->src[i], instruction);
+		deps->dst[i] = operand_reg(info->dst[i], instruction);
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Register dependences of an instruction word, for the timing models         */
+/******************************************************************************/
+#define REG_HI   32
+#define REG_LO   33
+#define NUM_DEP_REGS 34	/* GPRs, HI and LO */
+#define REG_NONE 0xFF
+
+typedef struct {
+	uint8_t src[2];	/* registers read, REG_NONE if unused */
+	uint8_t dst[2];	/* registers written, REG_NONE if unused */
+} inst_deps_t;
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void decode_deps(uint32_t instruction, inst_deps_t *deps);
+
+#endif
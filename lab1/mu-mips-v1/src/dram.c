@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "dram.h"
+
+#define ROW_NONE 0xFFFFFFFF
+
+int DRAM_FLAG = FALSE;
+
+static dram_config_t CFG = {
+	.channels = 1, .ranks = 1, .banks = 8,
+	.row_bytes = 8192,
+	.t_cas = 11, .t_rcd = 11, .t_rp = 11, .t_burst = 4,
+	.queue_size = 32,
+	.cpu_ratio = 4,
+	.scheduler = DRAM_FRFCFS,
+	.age_cap = 200
+};
+
+typedef struct {
+	int bank;	/* index into BANKS */
+	int channel;
+	uint32_t row;
+	int write;
+	uint64_t arrival;	/* DRAM cycle the request reached the controller */
+} dram_request_t;
+
+static struct {
+	uint32_t open_row;
+	uint64_t ready_at;	/* next cycle a command can start */
+	uint64_t hits, misses, conflicts;
+} BANKS[DRAM_MAX_BANKS];
+
+/* kept in arrival order; FR-FCFS may pick out of order */
+static dram_request_t QUEUE[DRAM_MAX_QUEUE];
+static int queue_len;
+
+static uint64_t bus_free[DRAM_MAX_BANKS];	/* per channel */
+static uint64_t ctrl_time;	/* earliest cycle for the controller's next command */
+static uint64_t cpu_time;	/* in-order core: 1 cycle per instruction plus memory stalls */
+static uint64_t last_done;
+
+static struct {
+	uint64_t reads, writes;
+	uint64_t read_latency, write_latency;	/* sums, arrival to last data beat */
+	uint64_t stall;		/* CPU cycles the core waited for memory */
+	uint64_t reordered;	/* requests FR-FCFS served ahead of an older one */
+} DRAM;
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int dram_configure(const char *spec) {
+	static const struct {
+		const char *name;
+		int *field;
+	} keys[] = {
+		{ "channels", &CFG.channels }, { "ranks", &CFG.ranks }, { "banks", &CFG.banks },
+		{ "row", &CFG.row_bytes }, { "tcas", &CFG.t_cas }, { "trcd", &CFG.t_rcd },
+		{ "trp", &CFG.t_rp }, { "tburst", &CFG.t_burst }, { "queue", &CFG.queue_size },
+		{ "ratio", &CFG.cpu_ratio }, { "cap", &CFG.age_cap }
+	};
+	char copy[256], name[32], value[32], *tok;
+	int i;
+
+	DRAM_FLAG = TRUE;
+	if (strcmp(spec, "default") == 0) {
+		dram_reset();
+		return TRUE;
+	}
+	strncpy(copy, spec, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (sscanf(tok, "%31[^=]=%31s", name, value) != 2) {
+			printf("Error: bad DRAM option %s\n", tok);
+			return FALSE;
+		}
+		if (strcmp(name, "sched") == 0) {
+			if (strcmp(value, "fcfs") == 0) {
+				CFG.scheduler = DRAM_FCFS;
+			} else if (strcmp(value, "frfcfs") == 0) {
+				CFG.scheduler = DRAM_FRFCFS;
+			} else {
+				printf("Error: unknown scheduler %s (use fcfs or frfcfs)\n", value);
+				return FALSE;
+			}
+			continue;
+		}
+		for (i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+			if (strcmp(name, keys[i].name) == 0) {
+				*keys[i].field = atoi(value);
+				break;
+			}
+		}
+		if (i == (int)(sizeof(keys) / sizeof(keys[0]))) {
+			printf("Error: unknown DRAM option %s\n", name);
+			return FALSE;
+		}
+	}
+
+	if (CFG.channels < 1 || CFG.ranks < 1 || CFG.banks < 1
+		|| CFG.channels * CFG.ranks * CFG.banks > DRAM_MAX_BANKS
+		|| CFG.row_bytes < DRAM_BURST_BYTES
+		|| CFG.t_cas < 1 || CFG.t_rcd < 1 || CFG.t_rp < 1 || CFG.t_burst < 1
+		|| CFG.queue_size < 1 || CFG.queue_size > DRAM_MAX_QUEUE || CFG.cpu_ratio < 1 || CFG.age_cap < 1) {
+		printf("Error: DRAM configuration out of range (at most %d banks in total, queue 1..%d, row >= %d bytes)\n",
+			DRAM_MAX_BANKS, DRAM_MAX_QUEUE, DRAM_BURST_BYTES);
+		return FALSE;
+	}
+	dram_reset();
+	return TRUE;
+}
+
+/***************************************************************/
+/* Close every row and clear the counters (on reset)           */
+/***************************************************************/
+void dram_reset() {
+	int i;
+
+	memset(BANKS, 0, sizeof(BANKS));
+	for (i = 0; i < DRAM_MAX_BANKS; i++) {
+		BANKS[i].open_row = ROW_NONE;
+	}
+	memset(bus_free, 0, sizeof(bus_free));
+	memset(&DRAM, 0, sizeof(DRAM));
+	queue_len = 0;
+	ctrl_time = cpu_time = last_done = 0;
+}
+
+/***************************************************************/
+/* Guest address -> channel/rank/bank/row, with consecutive    */
+/* rows interleaved across channels, then banks, then ranks    */
+/***************************************************************/
+static void map_address(uint32_t address, dram_request_t *req) {
+	uint32_t x = address / CFG.row_bytes;
+	int bank, rank;
+
+	req->channel = x % CFG.channels;
+	x /= CFG.channels;
+	bank = x % CFG.banks;
+	x /= CFG.banks;
+	rank = x % CFG.ranks;
+	req->row = x / CFG.ranks;
+	req->bank = (req->channel * CFG.ranks + rank) * CFG.banks + bank;
+}
+
+/***************************************************************/
+/* Issue the next request the scheduler picks; returns the     */
+/* DRAM cycle its data transfer ends                           */
+/***************************************************************/
+static uint64_t schedule_one(int *was_write) {
+	dram_request_t req;
+	uint64_t start, column, done;
+	uint32_t act;
+	int i, pick = 0;
+
+	/* requests are in arrival order, so the oldest has arrived first */
+	if (QUEUE[0].arrival > ctrl_time) {
+		ctrl_time = QUEUE[0].arrival;
+	}
+	if (CFG.scheduler == DRAM_FRFCFS && ctrl_time - QUEUE[0].arrival < (uint64_t)CFG.age_cap) {
+		for (i = 0; i < queue_len && QUEUE[i].arrival <= ctrl_time; i++) {
+			if (BANKS[QUEUE[i].bank].open_row == QUEUE[i].row) {
+				pick = i;
+				break;
+			}
+		}
+		if (pick > 0) {
+			DRAM.reordered++;
+		}
+	}
+	req = QUEUE[pick];
+	memmove(&QUEUE[pick], &QUEUE[pick + 1], (queue_len - pick - 1) * sizeof(QUEUE[0]));
+	queue_len--;
+
+	/* open-page policy: rows stay open until a conflict */
+	start = ctrl_time > BANKS[req.bank].ready_at ? ctrl_time : BANKS[req.bank].ready_at;
+	if (BANKS[req.bank].open_row == req.row) {
+		act = 0;
+		BANKS[req.bank].hits++;
+	} else if (BANKS[req.bank].open_row == ROW_NONE) {
+		act = CFG.t_rcd;
+		BANKS[req.bank].misses++;
+	} else {
+		act = CFG.t_rp + CFG.t_rcd;
+		BANKS[req.bank].conflicts++;
+	}
+	/* the column command waits until its burst can follow the last one */
+	column = start + act;
+	if (bus_free[req.channel] > column + CFG.t_cas) {
+		column = bus_free[req.channel] - CFG.t_cas;
+	}
+	done = column + CFG.t_cas + CFG.t_burst;
+	bus_free[req.channel] = done;
+	BANKS[req.bank].open_row = req.row;
+	BANKS[req.bank].ready_at = column + CFG.t_burst;
+	/* commands go out in scheduling order, one per cycle; a later
+	   request to another bank still overlaps this one's access */
+	ctrl_time = start + 1;
+
+	if (req.write) {
+		DRAM.write_latency += done - req.arrival;
+	} else {
+		DRAM.read_latency += done - req.arrival;
+	}
+	if (done > last_done) {
+		last_done = done;
+	}
+	*was_write = req.write;
+	return done;
+}
+
+/***************************************************************/
+/* Commands issued so far, for the energy model                */
+/***************************************************************/
+void dram_events(dram_events_t *events) {
+	int b, nbanks = CFG.channels * CFG.ranks * CFG.banks;
+
+	memset(events, 0, sizeof(*events));
+	for (b = 0; b < nbanks; b++) {
+		events->activates += BANKS[b].misses + BANKS[b].conflicts;
+		events->precharges += BANKS[b].conflicts;
+	}
+	events->reads = DRAM.reads;
+	events->writes = DRAM.writes;
+}
+
+/***************************************************************/
+/* CPU cycles of the in-order core, memory stalls included     */
+/***************************************************************/
+uint64_t dram_cycles() {
+	return cpu_time;
+}
+
+/***************************************************************/
+/* Send one retired instruction's data access to the memory    */
+/* controller; loads block the core, stores are posted         */
+/***************************************************************/
+void dram_retire(const retire_t *r) {
+	uint64_t now, done;
+	dram_request_t req;
+	int write;
+
+	cpu_time++;
+	if (r->iclass != CLASS_LOAD && r->iclass != CLASS_STORE) {
+		return;
+	}
+	now = cpu_time / CFG.cpu_ratio;
+
+	/* commands the controller would already have issued by now */
+	while (queue_len > 0 && ctrl_time < now) {
+		schedule_one(&write);
+	}
+	if (queue_len == CFG.queue_size) {
+		schedule_one(&write);	/* the core waits for the entry it frees */
+		if (ctrl_time * CFG.cpu_ratio > cpu_time) {
+			DRAM.stall += ctrl_time * CFG.cpu_ratio - cpu_time;
+			cpu_time = ctrl_time * CFG.cpu_ratio;
+			now = ctrl_time;
+		}
+	}
+
+	map_address(r->mem_addr, &req);
+	req.write = r->iclass == CLASS_STORE;
+	req.arrival = now;
+	QUEUE[queue_len++] = req;
+	if (req.write) {
+		DRAM.writes++;
+		return;
+	}
+	DRAM.reads++;
+
+	/* the core waits until this load's data is back; it is the
+	   only read in the queue, so the first read served is ours */
+	do {
+		done = schedule_one(&write);
+	} while (write);
+	if (done * CFG.cpu_ratio > cpu_time) {
+		DRAM.stall += done * CFG.cpu_ratio - cpu_time;
+		cpu_time = done * CFG.cpu_ratio;
+	}
+}
+
+/***************************************************************/
+/* Save or put back everything schedule_one() changes          */
+/***************************************************************/
+static void model_state(int save) {
+	static uint8_t banks[sizeof(BANKS)], queue[sizeof(QUEUE)], bus[sizeof(bus_free)], counters[sizeof(DRAM)];
+	static uint64_t ctrl, done;
+	static int len;
+
+	if (save) {
+		memcpy(banks, BANKS, sizeof(BANKS));
+		memcpy(queue, QUEUE, queue_len * sizeof(QUEUE[0]));
+		memcpy(bus, bus_free, sizeof(bus_free));
+		memcpy(counters, &DRAM, sizeof(DRAM));
+		len = queue_len;
+		ctrl = ctrl_time;
+		done = last_done;
+	} else {
+		memcpy(BANKS, banks, sizeof(BANKS));
+		memcpy(QUEUE, queue, len * sizeof(QUEUE[0]));
+		memcpy(bus_free, bus, sizeof(bus_free));
+		memcpy(&DRAM, counters, sizeof(DRAM));
+		queue_len = len;
+		ctrl_time = ctrl;
+		last_done = done;
+	}
+}
+
+/***************************************************************/
+/* Print latency, row-buffer behaviour and bandwidth           */
+/***************************************************************/
+void dram_report() {
+	uint64_t hits = 0, misses = 0, conflicts = 0, requests, elapsed;
+	int write, b, nbanks = CFG.channels * CFG.ranks * CFG.banks;
+	double peak;
+
+	/* let posted stores finish so every request is counted; the
+	   run may go on, so its controller is put back afterwards */
+	model_state(TRUE);
+	while (queue_len > 0) {
+		schedule_one(&write);
+	}
+	for (b = 0; b < nbanks; b++) {
+		hits += BANKS[b].hits;
+		misses += BANKS[b].misses;
+		conflicts += BANKS[b].conflicts;
+	}
+	requests = DRAM.reads + DRAM.writes;
+	elapsed = cpu_time / CFG.cpu_ratio > last_done ? cpu_time / CFG.cpu_ratio : last_done;
+	peak = (double)CFG.channels * DRAM_BURST_BYTES / CFG.t_burst;
+
+	printf("-------------------------------------------------------------\n");
+	printf("DRAM timing: %d channel(s) x %d rank(s) x %d banks, %d byte rows, tCAS-tRCD-tRP %d-%d-%d, %s\n",
+		CFG.channels, CFG.ranks, CFG.banks, CFG.row_bytes, CFG.t_cas, CFG.t_rcd, CFG.t_rp,
+		CFG.scheduler == DRAM_FRFCFS ? "FR-FCFS" : "FCFS");
+	printf("-------------------------------------------------------------\n");
+	printf("Requests\t\t: %llu (%llu reads, %llu writes)\n", (unsigned long long)requests,
+		(unsigned long long)DRAM.reads, (unsigned long long)DRAM.writes);
+	if (requests == 0) {
+		printf("\n");
+		model_state(FALSE);
+		return;
+	}
+	printf("Row hits\t\t: %llu (%.2f%%)\n", (unsigned long long)hits, 100.0 * hits / requests);
+	printf("Row misses (closed)\t: %llu\n", (unsigned long long)misses);
+	printf("Row conflicts\t\t: %llu\n", (unsigned long long)conflicts);
+	printf("Reordered by FR-FCFS\t: %llu\n", (unsigned long long)DRAM.reordered);
+	printf("Avg access latency\t: %.2f DRAM cycles (reads %.2f, posted writes %.2f)\n",
+		(double)(DRAM.read_latency + DRAM.write_latency) / requests,
+		DRAM.reads ? (double)DRAM.read_latency / DRAM.reads : 0.0,
+		DRAM.writes ? (double)DRAM.write_latency / DRAM.writes : 0.0);
+	printf("Elapsed\t\t\t: %llu DRAM cycles (%llu CPU cycles, %llu stalled on memory)\n",
+		(unsigned long long)elapsed, (unsigned long long)cpu_time, (unsigned long long)DRAM.stall);
+	printf("Bandwidth\t\t: %.3f bytes/DRAM cycle (%.2f%% of peak)\n",
+		(double)requests * DRAM_BURST_BYTES / elapsed,
+		100.0 * requests * DRAM_BURST_BYTES / elapsed / peak);
+	printf("-------------------------------------------------------------\n");
+	printf("[Bank]\t[Hits]\t\t[Misses]\t[Conflicts]\n");
+	for (b = 0; b < nbanks; b++) {
+		if (BANKS[b].hits + BANKS[b].misses + BANKS[b].conflicts) {
+			printf("%d\t%-12llu\t%-12llu\t%llu\n", b, (unsigned long long)BANKS[b].hits,
+				(unsigned long long)BANKS[b].misses, (unsigned long long)BANKS[b].conflicts);
+		}
+	}
+	printf("\n");
+	model_state(FALSE);
+}
@@ -0,0 +1,44 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdint.h>
+#include "stats.h"
+
+/******************************************************************************/
+/* Main-memory timing: banks, row buffers and a memory controller queue       */
+/******************************************************************************/
+#define DRAM_MAX_BANKS 256	/* channels x ranks x banks */
+#define DRAM_MAX_QUEUE 64
+#define DRAM_BURST_BYTES 64	/* one BL8 burst on a 64-bit bus */
+
+#define DRAM_FCFS   0
+#define DRAM_FRFCFS 1	/* row hits first, then oldest */
+
+typedef struct {
+	int channels, ranks, banks;
+	int row_bytes;		/* row buffer size per bank */
+	int t_cas, t_rcd, t_rp, t_burst;	/* in DRAM cycles */
+	int queue_size;
+	int cpu_ratio;		/* CPU cycles per DRAM cycle */
+	int scheduler;
+	int age_cap;		/* FR-FCFS serves the oldest request once it waited this long */
+} dram_config_t;
+
+typedef struct {
+	uint64_t activates, precharges;
+	uint64_t reads, writes;
+} dram_events_t;
+
+extern int DRAM_FLAG;	/* -d: send guest loads and stores through the model */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int dram_configure(const char *spec);
+void dram_reset();
+void dram_retire(const retire_t *r);
+void dram_report();
+void dram_events(dram_events_t *events);
+uint64_t dram_cycles();
+
+#endif
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "decode.h"
+#include "isa.h"
+#include "ooo.h"
+#include "dram.h"
+#include "energy.h"
+
+int ENERGY_FLAG = FALSE;
+
+/* 45 nm-class figures: an 8 KiB cache read per fetch and data access,
+   a 32-bit add, a 32-bit multiply and an iterative divide */
+static energy_config_t CFG = {
+	.fetch = 8.0,
+	.alu = 0.5, .mul = 3.1, .div = 15.0,
+	.load = 8.0, .store = 8.0,
+	.rf_read = 0.6, .rf_write = 0.8,
+	.dram_act = 1000.0, .dram_pre = 500.0, .dram_read = 800.0, .dram_write = 850.0,
+	.clock_mhz = 1000.0,
+	.cpi = 1.0,
+	.leak_mw = 0.0
+};
+
+enum { PART_FETCH, PART_EXECUTE, PART_REGFILE, PART_DRAM, NUM_PARTS };
+static const char *PART_NAMES[NUM_PARTS] = { "fetch", "execute", "register file", "dram" };
+
+static struct {
+	uint64_t instructions;
+	double by_class[NUM_INST_CLASSES];
+	double by_part[NUM_PARTS];
+	double other_pcs;	/* charged after the PC table filled up */
+} ENERGY;
+
+static struct {
+	uint32_t pc;
+	int used;
+	uint64_t count;
+	double pj;
+} PCS[ENERGY_PC_SLOTS];
+
+static dram_events_t dram_last;
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int energy_configure(const char *spec) {
+	static const struct {
+		const char *name;
+		double *field;
+	} keys[] = {
+		{ "fetch", &CFG.fetch }, { "alu", &CFG.alu }, { "mul", &CFG.mul }, { "div", &CFG.div },
+		{ "load", &CFG.load }, { "store", &CFG.store },
+		{ "rfread", &CFG.rf_read }, { "rfwrite", &CFG.rf_write },
+		{ "act", &CFG.dram_act }, { "pre", &CFG.dram_pre }, { "rd", &CFG.dram_read }, { "wr", &CFG.dram_write },
+		{ "clock", &CFG.clock_mhz }, { "cpi", &CFG.cpi }, { "leak", &CFG.leak_mw }
+	};
+	char copy[256], name[32], *tok;
+	double value;
+	int i;
+
+	ENERGY_FLAG = TRUE;
+	if (strcmp(spec, "default") == 0) {
+		return TRUE;
+	}
+	strncpy(copy, spec, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (sscanf(tok, "%31[^=]=%lf", name, &value) != 2 || value < 0) {
+			printf("Error: bad energy option %s\n", tok);
+			return FALSE;
+		}
+		for (i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+			if (strcmp(name, keys[i].name) == 0) {
+				*keys[i].field = value;
+				break;
+			}
+		}
+		if (i == (int)(sizeof(keys) / sizeof(keys[0]))) {
+			printf("Error: unknown energy option %s\n", name);
+			return FALSE;
+		}
+	}
+	if (CFG.clock_mhz <= 0 || CFG.cpi <= 0) {
+		printf("Error: energy configuration out of range (clock and cpi must be positive)\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Clear the accounts (on reset)                               */
+/***************************************************************/
+void energy_reset() {
+	memset(&ENERGY, 0, sizeof(ENERGY));
+	memset(PCS, 0, sizeof(PCS));
+	memset(&dram_last, 0, sizeof(dram_last));
+}
+
+static void charge_pc(uint32_t pc, double pj) {
+	uint32_t slot = (pc >> 2) % ENERGY_PC_SLOTS;
+	int probes;
+
+	for (probes = 0; probes < ENERGY_PC_SLOTS; probes++) {
+		if (!PCS[slot].used) {
+			PCS[slot].used = TRUE;
+			PCS[slot].pc = pc;
+		}
+		if (PCS[slot].pc == pc) {
+			PCS[slot].count++;
+			PCS[slot].pj += pj;
+			return;
+		}
+		slot = (slot + 1) % ENERGY_PC_SLOTS;
+	}
+	ENERGY.other_pcs += pj;
+}
+
+/***************************************************************/
+/* Charge one retired instruction; called by cycle() after the */
+/* timing models have seen it                                  */
+/***************************************************************/
+void energy_retire(const retire_t *r) {
+	double execute, regfile, dram = 0;
+	dram_events_t now;
+	inst_deps_t deps;
+	int i, op;
+
+	decode_deps(r->instruction, &deps);
+	regfile = 0;
+	for (i = 0; i < 2; i++) {
+		regfile += deps.src[i] != REG_NONE ? CFG.rf_read : 0;
+		regfile += deps.dst[i] != REG_NONE ? CFG.rf_write : 0;
+	}
+
+	switch (r->iclass) {
+	case CLASS_MULDIV:
+		op = isa_decode(r->instruction);
+		execute = op == ISA_DIV || op == ISA_DIVU ? CFG.div : CFG.mul;
+		break;
+	case CLASS_LOAD:
+		execute = CFG.alu + CFG.load;
+		break;
+	case CLASS_STORE:
+		execute = CFG.alu + CFG.store;
+		break;
+	default:
+		execute = CFG.alu;
+		break;
+	}
+
+	/* DRAM commands issued since the last instruction are charged to this one */
+	if (DRAM_FLAG) {
+		dram_events(&now);
+		dram = (now.activates - dram_last.activates) * CFG.dram_act
+			+ (now.precharges - dram_last.precharges) * CFG.dram_pre
+			+ (now.reads - dram_last.reads) * CFG.dram_read
+			+ (now.writes - dram_last.writes) * CFG.dram_write;
+		dram_last = now;
+	}
+
+	ENERGY.instructions++;
+	ENERGY.by_part[PART_FETCH] += CFG.fetch;
+	ENERGY.by_part[PART_EXECUTE] += execute;
+	ENERGY.by_part[PART_REGFILE] += regfile;
+	ENERGY.by_part[PART_DRAM] += dram;
+	ENERGY.by_class[r->iclass] += CFG.fetch + execute + regfile + dram;
+	charge_pc(r->pc, CFG.fetch + execute + regfile + dram);
+}
+
+static int by_energy(const void *a, const void *b) {
+	double x = PCS[*(const int *)a].pj, y = PCS[*(const int *)b].pj;
+
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/***************************************************************/
+/* Print total energy, average power and the breakdowns        */
+/***************************************************************/
+void energy_report() {
+	uint64_t cycles;
+	double dynamic = 0, leakage, total, seconds;
+	const char *source;
+	char text[ISA_TEXT_MAX];
+	int i, n, *order;
+
+	/* the most detailed timing model running sets the run time */
+	if (OOO_FLAG) {
+		cycles = ooo_cycles();
+		source = "out-of-order model";
+	} else if (DRAM_FLAG) {
+		cycles = dram_cycles();
+		source = "DRAM model";
+	} else {
+		cycles = (uint64_t)(ENERGY.instructions * CFG.cpi + 0.5);
+		source = "assumed CPI";
+	}
+	for (i = 0; i < NUM_PARTS; i++) {
+		dynamic += ENERGY.by_part[i];
+	}
+	seconds = cycles / (CFG.clock_mhz * 1e6);
+	leakage = CFG.leak_mw * 1e-3 * seconds * 1e12;
+	total = dynamic + leakage;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Energy: fetch %.2f, alu %.2f, mul %.2f, div %.2f, load %.2f, store %.2f pJ, %.0f MHz\n",
+		CFG.fetch, CFG.alu, CFG.mul, CFG.div, CFG.load, CFG.store, CFG.clock_mhz);
+	printf("-------------------------------------------------------------\n");
+	printf("Instructions\t\t: %llu\n", (unsigned long long)ENERGY.instructions);
+	if (ENERGY.instructions == 0 || cycles == 0) {
+		printf("\n");
+		return;
+	}
+	printf("Cycles\t\t\t: %llu (%s)\n", (unsigned long long)cycles, source);
+	printf("Total energy\t\t: %.3f uJ (%.2f pJ per instruction)\n", total * 1e-6, total / ENERGY.instructions);
+	printf("Average power\t\t: %.3f mW (%.3f mW dynamic, %.3f mW static)\n",
+		total * 1e-9 / seconds, dynamic * 1e-9 / seconds, CFG.leak_mw);
+	printf("-------------------------------------------------------------\n");
+	printf("[Component]\t\t[uJ]\t\t[Share]\n");
+	for (i = 0; i < NUM_PARTS; i++) {
+		printf("%-16s\t%.3f\t\t%.2f%%\n", PART_NAMES[i], ENERGY.by_part[i] * 1e-6, 100.0 * ENERGY.by_part[i] / total);
+	}
+	printf("%-16s\t%.3f\t\t%.2f%%\n", "static", leakage * 1e-6, 100.0 * leakage / total);
+	printf("-------------------------------------------------------------\n");
+	printf("[Class]\t\t\t[uJ]\t\t[Share]\n");
+	for (i = 0; i < NUM_INST_CLASSES; i++) {
+		printf("%-16s\t%.3f\t\t%.2f%%\n", CLASS_NAMES[i], ENERGY.by_class[i] * 1e-6, 100.0 * ENERGY.by_class[i] / total);
+	}
+	printf("-------------------------------------------------------------\n");
+	printf("[Hot PC]\t[Count]\t\t[uJ]\t\t[Share]\t[Instruction]\n");
+	order = malloc(ENERGY_PC_SLOTS * sizeof(*order));
+	for (i = n = 0; i < ENERGY_PC_SLOTS; i++) {
+		if (PCS[i].used) {
+			order[n++] = i;
+		}
+	}
+	qsort(order, n, sizeof(*order), by_energy);
+	for (i = 0; i < n && i < ENERGY_TOP_PCS; i++) {
+		text[isa_disassemble(mem_read_32(PCS[order[i]].pc), text)] = '\0';
+		printf("0x%08x\t%llu\t\t%.3f\t\t%.2f%%\t%s\n", PCS[order[i]].pc, (unsigned long long)PCS[order[i]].count,
+			PCS[order[i]].pj * 1e-6, 100.0 * PCS[order[i]].pj / total, text);
+	}
+	free(order);
+	if (ENERGY.other_pcs > 0) {
+		printf("(other PCs)\t\t\t%.3f\n", ENERGY.other_pcs * 1e-6);
+	}
+	printf("\n");
+}
@@ -0,0 +1,35 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+#include "stats.h"
+
+/******************************************************************************/
+/* Energy accounting: per-event costs charged as instructions retire          */
+/******************************************************************************/
+#define ENERGY_PC_SLOTS 65536	/* hot-PC table, open addressing */
+#define ENERGY_TOP_PCS  10
+
+typedef struct {
+	/* picojoules per event */
+	double fetch;			/* instruction fetch */
+	double alu, mul, div;	/* execute; loads, stores and branches use the ALU too */
+	double load, store;		/* data memory access */
+	double rf_read, rf_write;	/* per register operand */
+	double dram_act, dram_pre, dram_read, dram_write;	/* per DRAM command (-d) */
+	double clock_mhz;
+	double cpi;			/* cycles per instruction when no timing model runs */
+	double leak_mw;		/* static power */
+} energy_config_t;
+
+extern int ENERGY_FLAG;	/* -e: charge every retired instruction */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int energy_configure(const char *spec);
+void energy_reset();
+void energy_retire(const retire_t *r);
+void energy_report();
+
+#endif
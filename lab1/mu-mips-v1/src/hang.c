@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "isa.h"
+#include "hang.h"
+#include "mmu.h"
+
+int HANG_FLAG = FALSE;
+
+static hang_config_t CFG = { .loop = TRUE, .instrs = 0, .secs = 0 };
+
+static struct {
+	CPU_State state;
+	uint64_t generation;
+	uint32_t count;		/* INSTRUCTION_COUNT when first seen */
+	int used;
+} SEEN[HANG_SLOTS];
+
+/* bumped by everything that can change state outside the CPU registers,
+   so two equal register files only match with no such change in between */
+static uint64_t generation;
+static uint64_t retired;		/* since reset, for the instruction watchdog */
+static double elapsed;			/* seconds simulated before the current run */
+static struct timespec run_start;
+static uint32_t until_clock;
+static uint32_t until_sample = HANG_SAMPLE_EVERY;
+static uint32_t zero_run;		/* consecutive all-zero instruction words */
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int hang_configure(const char *spec) {
+	char copy[256], name[32], *tok;
+	double value;
+
+	HANG_FLAG = TRUE;
+	if (strcmp(spec, "default") == 0) {
+		return TRUE;
+	}
+	strncpy(copy, spec, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (sscanf(tok, "%31[^=]=%lf", name, &value) != 2 || value < 0) {
+			printf("Error: bad watchdog option %s\n", tok);
+			return FALSE;
+		}
+		if (strcmp(name, "loop") == 0) {
+			CFG.loop = value != 0;
+		} else if (strcmp(name, "instrs") == 0) {
+			CFG.instrs = (uint64_t)value;
+		} else if (strcmp(name, "secs") == 0) {
+			CFG.secs = value;
+		} else {
+			printf("Error: unknown watchdog option %s\n", name);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Forget the remembered states, e.g. after stepping backward  */
+/***************************************************************/
+void hang_forget() {
+	memset(SEEN, 0, sizeof(SEEN));
+}
+
+void hang_reset() {
+	hang_forget();
+	generation = 0;
+	retired = 0;
+	zero_run = 0;
+	until_sample = HANG_SAMPLE_EVERY;
+	elapsed = 0;
+}
+
+static double seconds_since(const struct timespec *t) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+}
+
+/***************************************************************/
+/* The wall-clock watchdog only counts time spent running      */
+/***************************************************************/
+void hang_begin() {
+	clock_gettime(CLOCK_MONOTONIC, &run_start);
+	until_clock = HANG_CLOCK_EVERY;
+}
+
+void hang_end() {
+	elapsed += seconds_since(&run_start);
+}
+
+/***************************************************************/
+/* Stop the run and say where and why                          */
+/***************************************************************/
+static void stop(const char *why, uint32_t loop_begin, uint32_t loop_end) {
+	char text[ISA_TEXT_MAX];
+	uint32_t pc;
+
+	RUN_FLAG = FALSE;
+	printf("Watchdog: %s\n", why);
+	printf("Stopped at PC 0x%08x after %u instructions (%.2f s)\n\n", CURRENT_STATE.PC, INSTRUCTION_COUNT,
+		elapsed + seconds_since(&run_start));
+	if (loop_end >= loop_begin && (loop_end - loop_begin) / 4 < HANG_LOOP_LISTING) {
+		printf("From the repeated PC to the branch back to it:\n");
+		for (pc = loop_begin; pc <= loop_end; pc += 4) {
+			text[isa_disassemble(mem_read_32(pc), text)] = '\0';
+			printf("  [0x%08x]\t%s\n", pc, text);
+		}
+		printf("\n");
+	}
+	rdump();
+}
+
+static uint64_t state_hash() {
+	uint64_t h = (CURRENT_STATE.PC ^ generation) * 0x9E3779B97F4A7C15ULL;
+	int i;
+
+	for (i = 0; i < MIPS_REGS; i++) {
+		h = (h ^ CURRENT_STATE.REGS[i]) * 0x9E3779B97F4A7C15ULL;
+	}
+	h = (h ^ CURRENT_STATE.HI) * 0x9E3779B97F4A7C15ULL;
+	h = (h ^ CURRENT_STATE.LO) * 0x9E3779B97F4A7C15ULL;
+	return h ^ (h >> 32);
+}
+
+/***************************************************************/
+/* Remember the state at a backward branch target; meeting it  */
+/* again with nothing else changed means the loop never ends   */
+/***************************************************************/
+static void check_loop(const retire_t *r) {
+	uint32_t slot = state_hash() % HANG_SLOTS;
+	char why[128];
+
+	/* a kernel idling with interrupts unmasked is waiting, not stuck */
+	if (KERNEL_LOADED && (CP0[CP0_STATUS] & STATUS_IE) && (CP0[CP0_STATUS] & CAUSE_IP)) {
+		return;
+	}
+	if (SEEN[slot].used && SEEN[slot].generation == generation
+		&& memcmp(&SEEN[slot].state, &CURRENT_STATE, sizeof(CPU_State)) == 0) {
+		snprintf(why, sizeof(why), "endless loop, the state after instruction %u repeats the one after %u",
+			INSTRUCTION_COUNT, SEEN[slot].count);
+		stop(why, CURRENT_STATE.PC, r->pc);
+		return;
+	}
+	SEEN[slot].state = CURRENT_STATE;
+	SEEN[slot].generation = generation;
+	SEEN[slot].count = INSTRUCTION_COUNT;
+	SEEN[slot].used = TRUE;
+}
+
+/***************************************************************/
+/* Account for the instruction just executed                   */
+/***************************************************************/
+void hang_retire(const retire_t *r) {
+	char why[128];
+
+	retired++;
+	/* stores, syscalls (memory, I/O, the heap break) and CP0 (TLB, exception state) */
+	if (r->iclass == CLASS_STORE || r->iclass == CLASS_SYSCALL || (r->instruction >> 26) == 0x10) {
+		generation++;
+	}
+	/* an endless loop meets its states again and again, so checking
+	   every so many backward branches still finds it, for a fraction
+	   of the cost */
+	if (CFG.loop && CURRENT_STATE.PC <= r->pc && --until_sample == 0) {
+		until_sample = HANG_SAMPLE_EVERY;
+		check_loop(r);
+	}
+	/* sliding through empty memory as NOPs never repeats a state
+	   until the PC wraps around, so catch it on its own */
+	zero_run = r->instruction == 0 ? zero_run + 1 : 0;
+	if (CFG.loop && zero_run == HANG_ZERO_RUN && RUN_FLAG) {
+		snprintf(why, sizeof(why), "ran off the program, %d instructions of empty memory since 0x%08x",
+			HANG_ZERO_RUN, r->pc - (HANG_ZERO_RUN - 1) * 4);
+		stop(why, 1, 0);
+	}
+	if (CFG.instrs != 0 && retired >= CFG.instrs && RUN_FLAG) {
+		snprintf(why, sizeof(why), "instruction limit of %llu reached", (unsigned long long)CFG.instrs);
+		stop(why, 1, 0);
+	}
+	if (CFG.secs != 0 && --until_clock == 0) {
+		until_clock = HANG_CLOCK_EVERY;
+		if (elapsed + seconds_since(&run_start) >= CFG.secs && RUN_FLAG) {
+			snprintf(why, sizeof(why), "time limit of %g s reached", CFG.secs);
+			stop(why, 1, 0);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef HANG_H
+#define HANG_H
+
+#include <stdint.h>
+#include "mu-mips.h"
+#include "stats.h"
+
+/******************************************************************************/
+/* Hang detection for unattended runs: a repeated architectural state at a    */
+/* backward branch target proves an endless loop; instruction and wall-clock  */
+/* watchdogs catch the rest                                                   */
+/******************************************************************************/
+#define HANG_SLOTS        1024	/* states remembered, direct mapped */
+#define HANG_SAMPLE_EVERY 64	/* backward branches between state checks */
+#define HANG_CLOCK_EVERY  65536	/* instructions between wall-clock checks */
+#define HANG_LOOP_LISTING 32	/* longest loop body printed in the diagnostic */
+#define HANG_ZERO_RUN     1024	/* consecutive zero words taken as running off the program */
+
+typedef struct {
+	int loop;			/* detect repeated states */
+	uint64_t instrs;	/* stop after this many instructions, 0 for no limit */
+	double secs;		/* stop after this much simulation time, 0 for no limit */
+} hang_config_t;
+
+extern int HANG_FLAG;	/* -w: watch for hangs */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int hang_configure(const char *spec);
+void hang_reset();
+void hang_forget();
+void hang_begin();
+void hang_end();
+void hang_retire(const retire_t *r);
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mu-mips.h"
+#include "image.h"
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME  0x100000001B3ULL
+
+const char *IMAGE_CACHE_DIR = NULL;
+
+static uint64_t file_hash, file_size;	/* of the program file last hashed */
+static uint64_t text_mapped;	/* bytes of the text region mapped from a cache file */
+
+#define PAGE_ROUND(n) (((uint64_t)(n) + IMAGE_PAGE - 1) & ~(uint64_t)(IMAGE_PAGE - 1))
+
+/***************************************************************/
+/* FNV-1a over the whole program file                          */
+/***************************************************************/
+static int hash_file(const char *path) {
+	uint8_t buf[65536];
+	size_t n, i;
+	FILE *fp;
+
+	fp = fopen(path, "rb");
+	if (fp == NULL) {
+		return FALSE;
+	}
+	file_hash = FNV_OFFSET;
+	file_size = 0;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		for (i = 0; i < n; i++) {
+			file_hash = (file_hash ^ buf[i]) * FNV_PRIME;
+		}
+		file_size += n;
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+static void cache_path(char *out, size_t size) {
+	snprintf(out, size, "%s/%016llx.img", IMAGE_CACHE_DIR, (unsigned long long)file_hash);
+}
+
+/***************************************************************/
+/* Put anonymous memory back over a text region mapped from a  */
+/* cache file; dropping its pages would bring the image back   */
+/***************************************************************/
+void image_release_text() {
+	if (text_mapped == 0) {
+		return;
+	}
+	if (mmap(MEM_REGIONS[0].mem, text_mapped, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+		printf("Error: Can't release the cached program image\n");
+		exit(-1);
+	}
+	text_mapped = 0;
+}
+
+/***************************************************************/
+/* Map the cached image of <path> if there is a valid one; the */
+/* words go over the text region copy-on-write                 */
+/***************************************************************/
+int image_load_cached(const char *path) {
+	image_header_t h;
+	char name[512];
+	uint64_t words_size;
+	struct stat st;
+	uint32_t i;
+	int fd;
+
+	if (!hash_file(path)) {
+		return FALSE;
+	}
+	cache_path(name, sizeof(name));
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+		return FALSE;
+	}
+	if (fstat(fd, &st) < 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+		close(fd);
+		return FALSE;
+	}
+	words_size = PAGE_ROUND((uint64_t)h.words * 4);
+	if (h.magic != IMAGE_MAGIC || h.version != IMAGE_VERSION
+		|| h.hash != file_hash || h.file_size != file_size
+		|| (uint64_t)h.words * 4 > MEM_TEXT_END - MEM_TEXT_BEGIN + 1
+		|| (uint64_t)st.st_size < IMAGE_PAGE + words_size) {
+		printf("Warning: ignoring stale program cache %s\n", name);
+		close(fd);
+		return FALSE;
+	}
+	if (h.words > 0 && mmap(MEM_REGIONS[0].mem, words_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_FIXED, fd, IMAGE_PAGE) == MAP_FAILED) {
+		close(fd);
+		return FALSE;
+	}
+	close(fd);
+	text_mapped = h.words > 0 ? words_size : 0;
+
+	PROGRAM_SIZE = h.words;
+	if (TRACE_FLAG) {
+		for (i = 0; i < h.words; i++) {
+			printf("writing 0x%08x into address 0x%08x (%d)\n", mem_read_32(MEM_TEXT_BEGIN + i * 4),
+				MEM_TEXT_BEGIN + i * 4, MEM_TEXT_BEGIN + i * 4);
+		}
+	}
+	printf("Program loaded from cache %s.\n%d words written into memory.\n\n", name, PROGRAM_SIZE);
+	return TRUE;
+}
+
+static int write_all(int fd, const void *buf, uint64_t len) {
+	const uint8_t *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, p, len);
+		if (n <= 0) {
+			return FALSE;
+		}
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Save the loaded program for the next start of the same     */
+/* file; written aside and renamed into place so a concurrent  */
+/* start never maps a partial file                             */
+/***************************************************************/
+void image_store(const char *path) {
+	static const uint8_t zeros[IMAGE_PAGE];
+	char name[512], tmp[540];
+	uint64_t words_size = PAGE_ROUND((uint64_t)PROGRAM_SIZE * 4);
+	image_header_t h;
+	uint8_t *text;
+	int fd, ok;
+
+	if (!hash_file(path)) {
+		return;
+	}
+	mkdir(IMAGE_CACHE_DIR, 0755);
+	cache_path(name, sizeof(name));
+	snprintf(tmp, sizeof(tmp), "%s.%d", name, (int)getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		printf("Warning: can't write program cache %s\n", tmp);
+		return;
+	}
+
+	memset(&h, 0, sizeof(h));
+	h.magic = IMAGE_MAGIC;
+	h.version = IMAGE_VERSION;
+	h.words = PROGRAM_SIZE;
+	h.hash = file_hash;
+	h.file_size = file_size;
+	text = mem_host_ptr(MEM_TEXT_BEGIN, NULL);
+
+	ok = write_all(fd, &h, sizeof(h)) && write_all(fd, zeros, IMAGE_PAGE - sizeof(h))
+		&& write_all(fd, text, (uint64_t)PROGRAM_SIZE * 4)
+		&& write_all(fd, zeros, words_size - (uint64_t)PROGRAM_SIZE * 4);
+	close(fd);
+	if (!ok || rename(tmp, name) < 0) {
+		printf("Warning: can't write program cache %s\n", name);
+		unlink(tmp);
+		return;
+	}
+	printf("Program image cached in %s.\n\n", name);
+}
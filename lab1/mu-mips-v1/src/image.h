@@ -0,0 +1,35 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Program image: the loaded words, kept in an on-disk cache keyed by the     */
+/* program file's content hash                                                */
+/*                                                                            */
+/* Cache file layout: header, zero padding to IMAGE_PAGE, then the words as   */
+/* they sit in guest memory padded to a page, so they can be mapped straight  */
+/* over the text region.                                                      */
+/******************************************************************************/
+#define IMAGE_MAGIC   0x474D494D	/* "MIMG" */
+#define IMAGE_VERSION 2
+#define IMAGE_PAGE    4096
+
+typedef struct {
+	uint32_t magic, version;
+	uint32_t words;
+	uint32_t reserved;
+	uint64_t hash;			/* FNV-1a of the program file */
+	uint64_t file_size;
+} image_header_t;
+
+extern const char *IMAGE_CACHE_DIR;	/* -c: where cached images live, NULL for none */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void image_release_text();
+int image_load_cached(const char *path);
+void image_store(const char *path);
+
+#endif
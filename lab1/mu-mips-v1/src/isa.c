@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "syscall.h"
+#include "stats.h"
+#include "mmu.h"
+#include "isa.h"
+
+#define ISA_KEY_OPCODE(code)  (code)
+#define ISA_KEY_SPECIAL(code) (64 + (code))
+#define ISA_KEY_REGIMM(code)  (128 + (code))
+#define ISA_KEY_COP0(code)    (160 + (code))
+#define ISA_KEY_COP0_CO(code) (192 + (code))
+
+const uint8_t ISA_DECODE[ISA_DECODE_SIZE] = {
+#define INST(name, group, code, ...) [ISA_KEY_##group(code)] = ISA_##name,
+#include "isa.def"
+#undef INST
+};
+
+const isa_info_t ISA_INFO[ISA_COUNT] = {
+	[ISA_INVALID] = { ".word", 5, FMT_NONE, CLASS_ALU, { OPND_NO, OPND_NO }, { OPND_NO, OPND_NO } },
+#define INST(name, group, code, format, iclass, dst0, dst1, src0, src1, ...) \
+	[ISA_##name] = { #name, sizeof(#name) - 1, format, iclass, \
+		{ OPND_##dst0, OPND_##dst1 }, { OPND_##src0, OPND_##src1 } },
+#include "isa.def"
+#undef INST
+};
+
+/* vocabulary of the isa.def bodies */
+#define GPR(n) CURRENT_STATE.REGS[n]
+#define SET(n) CURRENT_STATE.REGS[n]
+#define SEXT8(v)  (((v) & 0x80) ? 0xFFFFFF00 | (v) : (v))
+#define SEXT16(v) (((v) & 0x8000) ? 0xFFFF0000 | (v) : (v))
+#define BRANCH_OFFSET(imm) SEXT16((imm) << 2)	/* only bit 15 of the shifted value extends */
+#define LOAD(a)     (MMU_FLAG ? mmu_read_32(a, MMU_LOAD) : mem_read_32(a))
+#define STORE(a, v) (MMU_FLAG ? mmu_write_32(a, v) : mem_write_32(a, v))
+
+/* precise exceptions; only taken when a kernel handles them (-k), so plain
+   programs keep wrapping on overflow and accessing words at any address */
+#define TRAPS KERNEL_LOADED
+#define TRAP(code) mmu_exception(code)
+#define ALIGN_CHECK(a, size, code) \
+	if (TRAPS && ((a) & ((size) - 1))) { \
+		mmu_address_error(code, a); \
+	}
+
+/***************************************************************/
+/* Words the decoder doesn't know: a kernel gets a reserved    */
+/* instruction exception, otherwise report them like the old   */
+/* opcode switch did and move on                               */
+/***************************************************************/
+static int exec_INVALID(uint32_t instruction) {
+	if (TRAPS) {
+		TRAP(EXC_RI);
+	}
+	switch (instruction >> 26) {
+	case 0b000000:
+		printf("No Special Instruction Found\n");
+		break;
+	case 0b000001:
+		printf("No Register Type Instruction Found\n");
+		break;
+	default:
+		printf("No Normal Type Instruction Found\n");
+		break;
+	}
+	return 4;
+}
+
+#define INST(name, group, code, format, iclass, dst0, dst1, src0, src1, ...) \
+static int exec_##name(uint32_t instruction) { \
+	uint32_t rs = (instruction >> 21) & 0x1F; \
+	uint32_t rt = (instruction >> 16) & 0x1F; \
+	uint32_t rd = (instruction >> 11) & 0x1F; \
+	uint32_t sa = (instruction >> 6) & 0x1F; \
+	uint32_t immediate = instruction & 0xFFFF; \
+	uint32_t target = instruction & 0x03FFFFFF; \
+	int jump = 4; \
+	(void)rs; (void)rt; (void)rd; (void)sa; (void)immediate; (void)target; \
+	__VA_ARGS__ \
+	return jump; \
+}
+#include "isa.def"
+#undef INST
+
+int (*const ISA_EXEC[ISA_COUNT])(uint32_t instruction) = {
+	[ISA_INVALID] = exec_INVALID,
+#define INST(name, ...) [ISA_##name] = exec_##name,
+#include "isa.def"
+#undef INST
+};
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+/***************************************************************/
+/* Write <value> in lower-case hex, at least <width> digits,   */
+/* without a prefix or NUL; returns the end                    */
+/***************************************************************/
+char *isa_put_hex(char *p, uint32_t value, int width) {
+	char tmp[8];
+	int n = 0;
+
+	do {
+		tmp[n++] = HEX_DIGITS[value & 0xF];
+		value >>= 4;
+	} while (value != 0 || n < width);
+	while (n > 0) {
+		*p++ = tmp[--n];
+	}
+	return p;
+}
+
+static char *put_hex(char *p, uint32_t value) {
+	*p++ = '0';
+	*p++ = 'x';
+	return isa_put_hex(p, value, 1);
+}
+
+static char *put_dec(char *p, uint32_t value) {
+	char tmp[10];
+	int n = 0;
+
+	do {
+		tmp[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	while (n > 0) {
+		*p++ = tmp[--n];
+	}
+	return p;
+}
+
+static char *put_reg(char *p, uint32_t reg) {
+	*p++ = '$';
+	*p++ = 'r';
+	if (reg >= 10) {
+		*p++ = '0' + reg / 10;
+	}
+	*p++ = '0' + reg % 10;
+	return p;
+}
+
+static char *put_sep(char *p) {
+	*p++ = ',';
+	*p++ = ' ';
+	return p;
+}
+
+/***************************************************************/
+/* Write "MNEMONIC operands" for one instruction word, without */
+/* a newline; unknown words come out as ".word 0x..."          */
+/***************************************************************/
+int isa_disassemble(uint32_t instruction, char *text) {
+	const isa_info_t *info = &ISA_INFO[isa_decode(instruction)];
+	uint32_t rs = (instruction >> 21) & 0x1F;
+	uint32_t rt = (instruction >> 16) & 0x1F;
+	uint32_t rd = (instruction >> 11) & 0x1F;
+	uint32_t sa = (instruction >> 6) & 0x1F;
+	uint32_t immediate = instruction & 0xFFFF;
+	char *p = text;
+
+	memcpy(p, info->name, info->len);
+	p += info->len;
+	if (info == &ISA_INFO[ISA_INVALID]) {
+		*p++ = ' ';
+		return put_hex(p, instruction) - text;
+	}
+	if (info->format != FMT_NONE) {
+		*p++ = ' ';
+	}
+
+	switch (info->format) {
+	case FMT_RD_RS_RT:
+		p = put_sep(put_reg(p, rd));
+		p = put_sep(put_reg(p, rs));
+		p = put_reg(p, rt);
+		break;
+	case FMT_RS_RT:
+		p = put_sep(put_reg(p, rs));
+		p = put_reg(p, rt);
+		break;
+	case FMT_RD_RT_SA:
+		p = put_sep(put_reg(p, rd));
+		p = put_sep(put_reg(p, rt));
+		p = put_hex(p, sa);
+		break;
+	case FMT_RD:
+		p = put_reg(p, rd);
+		break;
+	case FMT_RS:
+		p = put_reg(p, rs);
+		break;
+	case FMT_RD_RS:
+		p = put_sep(put_reg(p, rd));
+		p = put_reg(p, rs);
+		break;
+	case FMT_RS_OFF:
+		p = put_sep(put_reg(p, rs));
+		p = put_hex(p, immediate << 2);
+		break;
+	case FMT_RS_RT_OFF:
+		p = put_sep(put_reg(p, rs));
+		p = put_sep(put_reg(p, rt));
+		p = put_hex(p, immediate << 2);
+		break;
+	case FMT_RT_RS_IMM:
+		p = put_sep(put_reg(p, rt));
+		p = put_sep(put_reg(p, rs));
+		p = put_hex(p, immediate);
+		break;
+	case FMT_RT_IMM_RS:
+		p = put_sep(put_reg(p, rt));
+		p = put_hex(p, immediate);
+		*p++ = '(';
+		p = put_reg(p, rs);
+		*p++ = ')';
+		break;
+	case FMT_RT_IMM:
+		p = put_sep(put_reg(p, rt));
+		p = put_hex(p, immediate);
+		break;
+	case FMT_TARGET:
+		p = put_dec(p, (instruction & 0x03FFFFFF) << 2);
+		break;
+	case FMT_RT_RD:
+		p = put_sep(put_reg(p, rt));
+		p = put_reg(p, rd);
+		break;
+	}
+	return p - text;
+}
@@ -0,0 +1,95 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Decoder, executor and disassembler tables, all generated from isa.def      */
+/******************************************************************************/
+
+/* operand layouts for the disassembler */
+enum {
+	FMT_NONE,
+	FMT_RD_RS_RT,
+	FMT_RS_RT,
+	FMT_RD_RT_SA,
+	FMT_RD,
+	FMT_RS,
+	FMT_RD_RS,
+	FMT_RS_OFF,		/* immediate << 2, before sign extension */
+	FMT_RS_RT_OFF,
+	FMT_RT_RS_IMM,
+	FMT_RT_IMM_RS,
+	FMT_RT_IMM,
+	FMT_TARGET,		/* target << 2 in decimal */
+	FMT_RT_RD		/* MFC0/MTC0: rd names a CP0 register */
+};
+
+/* register operands, resolved against the instruction word */
+enum {
+	OPND_NO,
+	OPND_RS,
+	OPND_RT,
+	OPND_RD,
+	OPND_HI,
+	OPND_LO,
+	OPND_V0,
+	OPND_A0,
+	OPND_RA
+};
+
+enum {
+	ISA_INVALID,	/* not in isa.def; executes as a no-op */
+#define INST(name, ...) ISA_##name,
+#include "isa.def"
+#undef INST
+	ISA_COUNT
+};
+
+typedef struct {
+	const char *name;
+	uint8_t len;		/* strlen(name) */
+	uint8_t format;		/* FMT_* */
+	uint8_t iclass;		/* CLASS_* */
+	uint8_t dst[2];		/* OPND_* */
+	uint8_t src[2];		/* OPND_* */
+} isa_info_t;
+
+/* ISA_DECODE is indexed by opcode, then 64 + funct for SPECIAL, 128 + rt for
+   REGIMM, 160 + rs for COP0 and 192 + funct for COP0 with the CO bit set */
+#define ISA_DECODE_SIZE 256
+
+extern const uint8_t ISA_DECODE[ISA_DECODE_SIZE];
+extern const isa_info_t ISA_INFO[ISA_COUNT];
+extern int (*const ISA_EXEC[ISA_COUNT])(uint32_t instruction);	/* return the PC increment */
+
+#define ISA_TEXT_MAX 48		/* longest line isa_disassemble() produces */
+
+/***************************************************************/
+/* Map an instruction word to its ISA_* number                 */
+/***************************************************************/
+static inline int isa_decode(uint32_t instruction) {
+	uint32_t opcode = instruction >> 26;
+
+	if (opcode == 0) {
+		return ISA_DECODE[64 + (instruction & 0x3F)];
+	}
+	if (opcode == 1) {
+		return ISA_DECODE[128 + ((instruction >> 16) & 0x1F)];
+	}
+	if (opcode == 0b010000) {
+		if (instruction & 0x02000000) {
+			return ISA_DECODE[192 + (instruction & 0x3F)];
+		}
+		return ISA_DECODE[160 + ((instruction >> 21) & 0x1F)];
+	}
+	return ISA_DECODE[opcode];
+}
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int isa_disassemble(uint32_t instruction, char *text);
+char *isa_put_hex(char *p, uint32_t value, int width);
+
+#endif
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "memio.h"
+#include "mmapseg.h"
+#include "isa.h"
+
+/***************************************************************/
+/* Map a format name ("bin" or "hex") to MEMIO_*, -1 if unknown */
+/***************************************************************/
+int memio_format(const char *name) {
+	if (name == NULL || name[0] == '\0' || strcmp(name, "bin") == 0) {
+		return MEMIO_BIN;
+	}
+	if (strcmp(name, "hex") == 0) {
+		return MEMIO_HEX;
+	}
+	return -1;
+}
+
+/***************************************************************/
+/* Host span for [addr, addr+count); for an unmapped address   */
+/* returns NULL and the size of the hole up to the next region */
+/***************************************************************/
+static uint8_t *span_at(uint32_t addr, uint32_t count, uint32_t *span) {
+	uint32_t avail, hole = count;
+	uint8_t *ptr = mem_host_ptr(addr, &avail);
+	int i;
+
+	if (ptr != NULL) {
+		*span = count < avail ? count : avail;
+		return ptr;
+	}
+	for (i = 0; i < NUM_MEM_REGION; i++) {
+		if (MEM_REGIONS[i].begin > addr && MEM_REGIONS[i].begin - addr < hole) {
+			hole = MEM_REGIONS[i].begin - addr;
+		}
+	}
+	*span = hole;
+	return NULL;
+}
+
+/***************************************************************/
+/* Write the words of one span as hex lines                    */
+/***************************************************************/
+static void hex_out(FILE *fp, const uint8_t *src, uint32_t count, char *line_buf) {
+	uint32_t i, word, len = 0;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		word = src ? (src[i] | (src[i+1] << 8) | (src[i+2] << 16) | ((uint32_t)src[i+3] << 24)) : 0;
+		isa_put_hex(line_buf + len, word, 8);
+		line_buf[len + 8] = '\n';
+		len += 9;
+		if (len + 9 > MEMIO_CHUNK) {
+			fwrite(line_buf, 1, len, fp);
+			len = 0;
+		}
+	}
+	fwrite(line_buf, 1, len, fp);
+}
+
+/***************************************************************/
+/* Stream the words from <start> to <stop> into a file         */
+/***************************************************************/
+void mdump_file(uint32_t start, uint32_t stop, const char *path, int format) {
+	uint64_t total, done = 0;
+	uint32_t addr, span, want;
+	uint8_t *src;
+	char *buf;
+	FILE *fp;
+
+	if (stop < start) {
+		printf("Error: empty range 0x%08x..0x%08x\n", start, stop);
+		return;
+	}
+	fp = fopen(path, format == MEMIO_HEX ? "w" : "wb");
+	if (fp == NULL) {
+		printf("Error: Can't open %s for writing\n", path);
+		return;
+	}
+	/* same words mdump would print: start, start+4, ... <= stop */
+	total = ((uint64_t)(stop - start) / 4 + 1) * 4;
+	buf = calloc(MEMIO_CHUNK, 1);
+	while (done < total) {
+		addr = start + (uint32_t)done;
+		want = (total - done) < MEMIO_CHUNK ? (uint32_t)(total - done) : MEMIO_CHUNK;
+		src = span_at(addr, want, &span);
+		if (format == MEMIO_HEX) {
+			hex_out(fp, src, span, buf);
+		} else if (src != NULL) {
+			fwrite(src, 1, span, fp);
+		} else {
+			memset(buf, 0, span);
+			fwrite(buf, 1, span, fp);
+		}
+		done += span;
+	}
+	free(buf);
+	fclose(fp);
+	printf("Wrote %llu bytes [0x%08x..0x%08x] to %s\n\n", (unsigned long long)total, start, stop, path);
+}
+
+/***************************************************************/
+/* Copy bytes into guest memory, skipping unmapped holes       */
+/***************************************************************/
+static void guest_copy_in(uint32_t addr, const uint8_t *src, uint32_t count) {
+	uint32_t span;
+	uint8_t *dst;
+
+	while (count > 0) {
+		dst = span_at(addr, count, &span);
+		if (dst != NULL && !(MMAP_RO_WINDOWS && mmap_read_only(addr, span))) {
+			memcpy(dst, src, span);
+		}
+		addr += span;
+		src += span;
+		count -= span;
+	}
+}
+
+/***************************************************************/
+/* Load a file into guest memory starting at <start>           */
+/***************************************************************/
+void mload_file(uint32_t start, const char *path, int format) {
+	uint64_t loaded = 0;
+	uint8_t *buf, word_bytes[MEMIO_CHUNK / 2];
+	uint32_t word = 0, nbytes = 0;
+	size_t n, i;
+	int digits = 0, c;
+	FILE *fp;
+
+	fp = fopen(path, format == MEMIO_HEX ? "r" : "rb");
+	if (fp == NULL) {
+		printf("Error: Can't open %s\n", path);
+		return;
+	}
+	buf = malloc(MEMIO_CHUNK);
+	while ((n = fread(buf, 1, MEMIO_CHUNK, fp)) > 0) {
+		if (format != MEMIO_HEX) {
+			guest_copy_in(start + (uint32_t)loaded, buf, n);
+			loaded += n;
+			continue;
+		}
+		for (i = 0; i < n; i++) {
+			c = buf[i];
+			if (c >= '0' && c <= '9') {
+				c -= '0';
+			} else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+				c = (c | 0x20) - 'a' + 10;
+			} else {
+				c = -1;
+			}
+			if (c >= 0) {
+				word = (word << 4) | c;
+				digits++;
+				continue;
+			}
+			if (digits == 0) {
+				continue;
+			}
+			/* end of a word: store it little-endian like mem_write_32 */
+			word_bytes[nbytes++] = word & 0xFF;
+			word_bytes[nbytes++] = (word >> 8) & 0xFF;
+			word_bytes[nbytes++] = (word >> 16) & 0xFF;
+			word_bytes[nbytes++] = (word >> 24) & 0xFF;
+			word = 0;
+			digits = 0;
+			if (nbytes == sizeof(word_bytes)) {
+				guest_copy_in(start + (uint32_t)loaded, word_bytes, nbytes);
+				loaded += nbytes;
+				nbytes = 0;
+			}
+		}
+	}
+	if (digits > 0) {
+		word_bytes[nbytes++] = word & 0xFF;
+		word_bytes[nbytes++] = (word >> 8) & 0xFF;
+		word_bytes[nbytes++] = (word >> 16) & 0xFF;
+		word_bytes[nbytes++] = (word >> 24) & 0xFF;
+	}
+	if (nbytes > 0) {
+		guest_copy_in(start + (uint32_t)loaded, word_bytes, nbytes);
+		loaded += nbytes;
+	}
+	free(buf);
+	fclose(fp);
+	printf("Loaded %llu bytes from %s at 0x%08x\n\n", (unsigned long long)loaded, path, start);
+}
@@ -0,0 +1,21 @@
+#ifndef MEMIO_H
+#define MEMIO_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Bulk transfer of guest memory to and from host files                       */
+/******************************************************************************/
+#define MEMIO_BIN 0	/* raw little-endian bytes */
+#define MEMIO_HEX 1	/* one word per line, same as program files */
+
+#define MEMIO_CHUNK (1 << 16)
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int memio_format(const char *name);
+void mdump_file(uint32_t start, uint32_t stop, const char *path, int format);
+void mload_file(uint32_t start, const char *path, int format);
+
+#endif
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mu-mips.h"
+#include "mmapseg.h"
+#include "mmu.h"
+
+static const char *MODE_NAMES[] = { "ro", "cow", "shared" };
+
+static mmap_window_t WINDOWS[MMAP_MAX_WINDOWS];
+static int num_windows = 0;
+int MMAP_RO_WINDOWS = 0;
+
+/***************************************************************/
+/* Map a mode name to MMAP_*, -1 if unknown                    */
+/***************************************************************/
+int mmap_mode(const char *name) {
+	int i;
+
+	if (name == NULL || name[0] == '\0') {
+		return MMAP_RO;
+	}
+	for (i = 0; i <= MMAP_SHARED; i++) {
+		if (strcmp(name, MODE_NAMES[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/***************************************************************/
+/* Map a host file at a page-aligned address in the data region */
+/***************************************************************/
+void mmap_file(uint32_t address, const char *path, int mode) {
+	mem_region_t *data = &MEM_REGIONS[1];
+	uint64_t length, last;
+	struct stat st;
+	void *host;
+	int fd, i;
+
+	if (num_windows == MMAP_MAX_WINDOWS) {
+		printf("Error: at most %d files can be mapped\n", MMAP_MAX_WINDOWS);
+		return;
+	}
+	if (address % MMAP_PAGE_SIZE != 0) {
+		printf("Error: 0x%08x is not aligned to a %d byte page\n", address, MMAP_PAGE_SIZE);
+		return;
+	}
+	fd = open(path, mode == MMAP_SHARED ? O_RDWR : O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+		printf("Error: Can't map %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return;
+	}
+	length = ((uint64_t)st.st_size + MMAP_PAGE_SIZE - 1) & ~(uint64_t)(MMAP_PAGE_SIZE - 1);
+	last = (uint64_t)address + length - 1;
+	if (address < data->begin || last > data->end) {
+		printf("Error: %s (%llu bytes) does not fit in the data region at 0x%08x\n",
+			path, (unsigned long long)st.st_size, address);
+		close(fd);
+		return;
+	}
+	for (i = 0; i < num_windows; i++) {
+		if (address <= WINDOWS[i].end && last >= WINDOWS[i].begin) {
+			printf("Error: 0x%08x..0x%08x overlaps %s\n", address, (uint32_t)last, WINDOWS[i].path);
+			close(fd);
+			return;
+		}
+	}
+
+	/* replace the anonymous pages behind the window; nothing is read yet */
+	host = mmap(data->mem + (address - data->begin), length,
+		mode == MMAP_RO ? PROT_READ : PROT_READ | PROT_WRITE,
+		MAP_FIXED | (mode == MMAP_SHARED ? MAP_SHARED : MAP_PRIVATE), fd, 0);
+	close(fd);
+	if (host == MAP_FAILED) {
+		printf("Error: mmap of %s failed\n", path);
+		return;
+	}
+
+	WINDOWS[num_windows].begin = address;
+	WINDOWS[num_windows].end = (uint32_t)last;
+	WINDOWS[num_windows].mode = mode;
+	strncpy(WINDOWS[num_windows].path, path, sizeof(WINDOWS[num_windows].path) - 1);
+	num_windows++;
+	if (mode == MMAP_RO) {
+		MMAP_RO_WINDOWS++;
+		mmu_flush_host();	/* cached translations may bypass the new window */
+	}
+	printf("Mapped %s (%llu bytes, %s) at 0x%08x..0x%08x\n\n", path,
+		(unsigned long long)st.st_size, MODE_NAMES[mode], address, (uint32_t)last);
+}
+
+/***************************************************************/
+/* Print the mapped files                                      */
+/***************************************************************/
+void mmap_list() {
+	int i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("[Guest range]\t\t\t[Mode]\t[File]\n");
+	printf("-------------------------------------------------------------\n");
+	for (i = 0; i < num_windows; i++) {
+		printf("0x%08x..0x%08x\t%s\t%s\n", WINDOWS[i].begin, WINDOWS[i].end,
+			MODE_NAMES[WINDOWS[i].mode], WINDOWS[i].path);
+	}
+	printf("\n");
+}
+
+/***************************************************************/
+/* Push guest stores in shared windows back to their files     */
+/***************************************************************/
+void mmap_sync(int wait) {
+	mem_region_t *data = &MEM_REGIONS[1];
+	int i;
+
+	for (i = 0; i < num_windows; i++) {
+		if (WINDOWS[i].mode == MMAP_SHARED) {
+			msync(data->mem + (WINDOWS[i].begin - data->begin),
+				(size_t)WINDOWS[i].end - WINDOWS[i].begin + 1, wait ? MS_SYNC : MS_ASYNC);
+		}
+	}
+}
+
+/***************************************************************/
+/* True if [address, address+count) touches a read-only file  */
+/***************************************************************/
+int mmap_read_only(uint32_t address, uint32_t count) {
+	uint64_t last = (uint64_t)address + count - 1;
+	int i;
+
+	for (i = 0; i < num_windows; i++) {
+		if (WINDOWS[i].mode == MMAP_RO && address <= WINDOWS[i].end && last >= WINDOWS[i].begin) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/***************************************************************/
+/* Turn the shared windows into private copies of the files,   */
+/* so a forked process can't store into them; false on failure */
+/***************************************************************/
+int mmap_detach() {
+	mem_region_t *data = &MEM_REGIONS[1];
+	size_t length;
+	void *host;
+	int fd, i;
+
+	for (i = 0; i < num_windows; i++) {
+		if (WINDOWS[i].mode != MMAP_SHARED) {
+			continue;
+		}
+		fd = open(WINDOWS[i].path, O_RDONLY);
+		if (fd < 0) {
+			return FALSE;
+		}
+		length = (size_t)WINDOWS[i].end - WINDOWS[i].begin + 1;
+		host = mmap(data->mem + (WINDOWS[i].begin - data->begin), length,
+			PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (host == MAP_FAILED) {
+			return FALSE;
+		}
+		WINDOWS[i].mode = MMAP_COW;
+	}
+	return TRUE;
+}
@@ -0,0 +1,34 @@
+#ifndef MMAPSEG_H
+#define MMAPSEG_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Host files mapped into the guest data region                               */
+/******************************************************************************/
+#define MMAP_RO     0	/* read-only, guest stores stop the simulation */
+#define MMAP_COW    1	/* private copy-on-write, reset reverts to the file */
+#define MMAP_SHARED 2	/* guest stores are written back to the file */
+
+#define MMAP_MAX_WINDOWS 16
+#define MMAP_PAGE_SIZE   4096
+
+typedef struct {
+	uint32_t begin, end;	/* guest addresses, end inclusive */
+	int mode;
+	char path[256];
+} mmap_window_t;
+
+extern int MMAP_RO_WINDOWS;	/* number of read-only windows, 0 keeps stores on the fast path */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int mmap_mode(const char *name);
+void mmap_file(uint32_t address, const char *path, int mode);
+void mmap_list();
+void mmap_sync(int wait);
+int mmap_read_only(uint32_t address, uint32_t count);
+int mmap_detach();
+
+#endif
@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "mmapseg.h"
+#include "mmu.h"
+
+int MMU_FLAG = FALSE;
+int KERNEL_LOADED = FALSE;
+uint32_t CP0[NUM_CP0_REGS];
+jmp_buf MMU_FAULT;
+int MMU_FAULTED = FALSE;
+uint32_t TIMER_DUE;
+mmu_host_t HOST_READ[MMU_HOST_ENTRIES], HOST_WRITE[MMU_HOST_ENTRIES];
+mmu_stats_t MMU;
+
+static mmu_config_t CFG = { .tlb_entries = MMU_MAX_TLB, .hw_walk = FALSE, .pt_base = 0 };
+
+static struct {
+	uint32_t hi, lo;	/* EntryHi and EntryLo layout */
+} TLB[MMU_MAX_TLB];
+
+static const char *EXC_NAMES[NUM_EXC] = {
+	"Int", "Mod", "TLBL", "TLBS", "AdEL", "AdES", "IBE", "DBE", "Sys", "Bp", "RI", "CpU", "Ov", "Tr"
+};
+
+static char kernel_file[256];
+static uint32_t fault_vector;	/* where cycle() resumes after mmu_raise() */
+static uint32_t count_offset;	/* Count - INSTRUCTION_COUNT */
+static int timer_armed;			/* Compare was written since reset */
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int mmu_configure(const char *spec) {
+	char copy[256], name[32], value[32], *tok;
+
+	MMU_FLAG = TRUE;
+	if (strcmp(spec, "default") == 0) {
+		return TRUE;
+	}
+	strncpy(copy, spec, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (sscanf(tok, "%31[^=]=%31s", name, value) != 2) {
+			printf("Error: bad MMU option %s\n", tok);
+			return FALSE;
+		}
+		if (strcmp(name, "tlb") == 0) {
+			CFG.tlb_entries = atoi(value);
+		} else if (strcmp(name, "ptbase") == 0) {
+			CFG.pt_base = strtoul(value, NULL, 0);
+		} else if (strcmp(name, "walk") == 0) {
+			if (strcmp(value, "sw") == 0) {
+				CFG.hw_walk = FALSE;
+			} else if (strcmp(value, "hw") == 0) {
+				CFG.hw_walk = TRUE;
+			} else {
+				printf("Error: unknown TLB refill %s (use sw or hw)\n", value);
+				return FALSE;
+			}
+		} else {
+			printf("Error: unknown MMU option %s\n", name);
+			return FALSE;
+		}
+	}
+
+	if (CFG.tlb_entries <= MMU_WIRED || CFG.tlb_entries > MMU_MAX_TLB
+		|| (CFG.pt_base & ~CONTEXT_PTEBASE) != 0
+		|| (CFG.pt_base != 0 && CFG.pt_base < MEM_KTEXT_BEGIN)) {
+		printf("Error: MMU configuration out of range (tlb %d..%d, ptbase a 2 MiB aligned kernel address)\n",
+			MMU_WIRED + 1, MMU_MAX_TLB);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int load_kernel() {
+	FILE *fp;
+	uint32_t word, address = MEM_KTEXT_BEGIN;
+
+	fp = fopen(kernel_file, "r");
+	if (fp == NULL) {
+		printf("Error: Can't open kernel file %s\n", kernel_file);
+		return FALSE;
+	}
+	while (fscanf(fp, "%x\n", &word) == 1 && address <= MEM_KTEXT_END - 3) {
+		mem_write_32(address, word);
+		address += 4;
+	}
+	fclose(fp);
+	printf("Kernel loaded into memory.\n%d words written at 0x%08x.\n\n",
+		(address - MEM_KTEXT_BEGIN) / 4, MEM_KTEXT_BEGIN);
+	return TRUE;
+}
+
+/***************************************************************/
+/* Load the kernel image that handles exceptions; the machine  */
+/* then starts at MMU_BOOT_VECTOR in kernel mode               */
+/***************************************************************/
+int mmu_load_kernel(const char *path) {
+	strncpy(kernel_file, path, sizeof(kernel_file) - 1);
+	KERNEL_LOADED = TRUE;
+	mmu_reset();
+	return KERNEL_LOADED;
+}
+
+/***************************************************************/
+/* Drop every host translation, e.g. when the ASID changes     */
+/***************************************************************/
+void mmu_flush_host() {
+	int i;
+
+	for (i = 0; i < MMU_HOST_ENTRIES; i++) {
+		HOST_READ[i].vpn = HOST_WRITE[i].vpn = MMU_NO_PAGE;
+	}
+}
+
+static void host_invalidate(uint32_t vpn) {
+	if (HOST_READ[vpn % MMU_HOST_ENTRIES].vpn == vpn) {
+		HOST_READ[vpn % MMU_HOST_ENTRIES].vpn = MMU_NO_PAGE;
+	}
+	if (HOST_WRITE[vpn % MMU_HOST_ENTRIES].vpn == vpn) {
+		HOST_WRITE[vpn % MMU_HOST_ENTRIES].vpn = MMU_NO_PAGE;
+	}
+}
+
+/***************************************************************/
+/* Empty the TLB, clear CP0 and the counters (on reset); the   */
+/* kernel is reloaded since reset dropped guest memory         */
+/***************************************************************/
+void mmu_reset() {
+	int i;
+
+	/* unused entries map kernel pages, which never match a user lookup */
+	for (i = 0; i < MMU_MAX_TLB; i++) {
+		TLB[i].hi = MEM_KTEXT_BEGIN + (i << MMU_PAGE_BITS);
+		TLB[i].lo = 0;
+	}
+	mmu_flush_host();
+	memset(CP0, 0, sizeof(CP0));
+	memset(&MMU, 0, sizeof(MMU));
+	count_offset = 0;
+	timer_armed = FALSE;
+	TIMER_DUE = 0;
+	CP0[CP0_CONTEXT] = CFG.pt_base;
+	if (KERNEL_LOADED) {
+		KERNEL_LOADED = load_kernel();
+	}
+	CP0[CP0_STATUS] = KERNEL_LOADED ? STATUS_EXL : 0;
+}
+
+static int random_index() {
+	return MMU_WIRED + INSTRUCTION_COUNT % (CFG.tlb_entries - MMU_WIRED);
+}
+
+static int tlb_find(uint32_t hi) {
+	int i;
+
+	for (i = 0; i < CFG.tlb_entries; i++) {
+		if ((TLB[i].hi & ENTRYHI_VPN) == (hi & ENTRYHI_VPN)
+			&& ((TLB[i].lo & ENTRYLO_G) || (TLB[i].hi & ENTRYHI_ASID) == (hi & ENTRYHI_ASID))) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void tlb_set(int i, uint32_t hi, uint32_t lo) {
+	host_invalidate(TLB[i].hi >> MMU_PAGE_BITS);
+	host_invalidate(hi >> MMU_PAGE_BITS);
+	TLB[i].hi = hi & (ENTRYHI_VPN | ENTRYHI_ASID);
+	TLB[i].lo = lo & (ENTRYLO_PFN | ENTRYLO_D | ENTRYLO_V | ENTRYLO_G);
+}
+
+/***************************************************************/
+/* Enter the kernel; never returns to the faulting instruction */
+/***************************************************************/
+static void enter(int code, int refill) {
+	MMU.exceptions[code]++;
+	if (!KERNEL_LOADED) {
+		if (code >= EXC_MOD && code <= EXC_ADES) {
+			printf("Error: %s exception at 0x%08x (PC 0x%08x) with no kernel loaded, stopping simulation\n",
+				EXC_NAMES[code], CP0[CP0_BADVADDR], CURRENT_STATE.PC);
+		} else {
+			printf("Error: %s exception at PC 0x%08x with no kernel loaded, stopping simulation\n",
+				EXC_NAMES[code], CURRENT_STATE.PC);
+		}
+		RUN_FLAG = FALSE;
+		fault_vector = CURRENT_STATE.PC;
+		longjmp(MMU_FAULT, 1);
+	}
+	/* a fault inside a handler keeps the first EPC, as on MIPS32 */
+	if (CP0[CP0_STATUS] & STATUS_EXL) {
+		fault_vector = MMU_GENERAL_VECTOR;
+	} else {
+		CP0[CP0_EPC] = CURRENT_STATE.PC;
+		fault_vector = refill ? MMU_REFILL_VECTOR : MMU_GENERAL_VECTOR;
+	}
+	CP0[CP0_CAUSE] = (CP0[CP0_CAUSE] & ~0x7C) | (code << 2);
+	CP0[CP0_STATUS] |= STATUS_EXL;
+	longjmp(MMU_FAULT, 1);
+}
+
+static void mmu_raise(int code, uint32_t address, int refill) {
+	CP0[CP0_BADVADDR] = address;
+	CP0[CP0_CONTEXT] = (CP0[CP0_CONTEXT] & CONTEXT_PTEBASE) | (((address >> MMU_PAGE_BITS) << 2) & ~CONTEXT_PTEBASE);
+	CP0[CP0_ENTRYHI] = (address & ENTRYHI_VPN) | (CP0[CP0_ENTRYHI] & ENTRYHI_ASID);
+	enter(code, refill);
+}
+
+/***************************************************************/
+/* Exceptions the instructions raise (overflow, divide by zero,*/
+/* unknown opcodes); with nothing to catch them, i.e. neither  */
+/* -m nor -k, the run stops on this instruction, unretired     */
+/***************************************************************/
+void mmu_exception(int code) {
+	if (!MMU_TRAPS) {
+		MMU.exceptions[code]++;
+		printf("Error: %s exception at PC 0x%08x with no kernel loaded, stopping simulation\n",
+			EXC_NAMES[code], CURRENT_STATE.PC);
+		RUN_FLAG = FALSE;
+		MMU_FAULTED = TRUE;
+		return;
+	}
+	enter(code, FALSE);
+}
+
+/* misaligned loads, stores and fetches */
+void mmu_address_error(int code, uint32_t address) {
+	CP0[CP0_BADVADDR] = address;
+	enter(code, FALSE);
+}
+
+/***************************************************************/
+/* Count reached Compare: post the timer interrupt             */
+/***************************************************************/
+void mmu_timer() {
+	if (timer_armed) {
+		CP0[CP0_CAUSE] |= CAUSE_IP_TIMER;
+	}
+}
+
+/***************************************************************/
+/* A pending interrupt is unmasked: take it before the next    */
+/* instruction, which is where ERET comes back to              */
+/***************************************************************/
+void mmu_interrupt() {
+	if ((CP0[CP0_STATUS] & (STATUS_IE | STATUS_EXL)) == STATUS_IE) {
+		enter(EXC_INT, FALSE);
+	}
+}
+
+/***************************************************************/
+/* Hardware refill: load the PTE Context points at into a      */
+/* random entry; -1 if the page table has no valid mapping     */
+/***************************************************************/
+static int walk(uint32_t address, uint32_t hi) {
+	uint32_t pte = mem_read_32((CP0[CP0_CONTEXT] & CONTEXT_PTEBASE) | ((address >> MMU_PAGE_BITS) << 2));
+	int i;
+
+	if (!(pte & ENTRYLO_V)) {
+		return -1;
+	}
+	i = random_index();
+	tlb_set(i, hi, pte);
+	MMU.walks++;
+	return i;
+}
+
+/***************************************************************/
+/* Virtual to physical, raising the exception the access earns */
+/***************************************************************/
+static uint32_t translate(uint32_t address, int access) {
+	uint32_t hi = (address & ENTRYHI_VPN) | (CP0[CP0_ENTRYHI] & ENTRYHI_ASID);
+	int miss = access == MMU_STORE ? EXC_TLBS : EXC_TLBL;
+	int i;
+
+	if (address >= MEM_KTEXT_BEGIN) {
+		if (!(CP0[CP0_STATUS] & STATUS_EXL)) {
+			mmu_raise(access == MMU_STORE ? EXC_ADES : EXC_ADEL, address, FALSE);
+		}
+		return address;
+	}
+	MMU.lookups++;
+	i = tlb_find(hi);
+	if (i < 0) {
+		MMU.misses++;
+		if (CFG.hw_walk) {
+			i = walk(address, hi);
+		}
+		if (i < 0) {
+			mmu_raise(miss, address, !CFG.hw_walk);
+		}
+	}
+	if (!(TLB[i].lo & ENTRYLO_V)) {
+		mmu_raise(miss, address, FALSE);
+	}
+	if (access == MMU_STORE && !(TLB[i].lo & ENTRYLO_D)) {
+		mmu_raise(EXC_MOD, address, FALSE);
+	}
+	return (TLB[i].lo & ENTRYLO_PFN) | (address & (MMU_PAGE_SIZE - 1));
+}
+
+static void host_fill(mmu_host_t *cache, uint32_t address, uint32_t physical) {
+	uint32_t avail;
+	uint8_t *host = mem_host_ptr(physical & ~(MMU_PAGE_SIZE - 1), &avail);
+
+	if (host != NULL && avail >= MMU_PAGE_SIZE) {
+		cache[(address >> MMU_PAGE_BITS) % MMU_HOST_ENTRIES].vpn = address >> MMU_PAGE_BITS;
+		cache[(address >> MMU_PAGE_BITS) % MMU_HOST_ENTRIES].host = host;
+	}
+}
+
+/***************************************************************/
+/* Host cache misses: translate through the TLB and remember   */
+/* the page; kernel addresses are not cached since they depend */
+/* on the mode                                                 */
+/***************************************************************/
+uint32_t mmu_read_slow(uint32_t address, int access) {
+	uint32_t physical = translate(address, access);
+
+	if (address < MEM_KTEXT_BEGIN) {
+		host_fill(HOST_READ, address, physical);
+	}
+	return mem_read_32(physical);
+}
+
+void mmu_write_slow(uint32_t address, uint32_t value) {
+	uint32_t physical = translate(address, MMU_STORE);
+
+	/* stores to read-only file windows must keep going through mem_write_32 */
+	if (address < MEM_KTEXT_BEGIN && MMAP_RO_WINDOWS == 0) {
+		host_fill(HOST_WRITE, address, physical);
+	}
+	mem_write_32(physical, value);
+}
+
+/***************************************************************/
+/* Host bytes behind a user address for the syscall layer, up  */
+/* to the end of its page; NULL instead of an exception when   */
+/* neither the TLB nor the page table at Context maps it       */
+/***************************************************************/
+uint8_t *mmu_guest_ptr(uint32_t address, int write, uint32_t *avail) {
+	uint32_t hi = (address & ENTRYHI_VPN) | (CP0[CP0_ENTRYHI] & ENTRYHI_ASID);
+	uint32_t left = MMU_PAGE_SIZE - (address & (MMU_PAGE_SIZE - 1));
+	uint32_t lo;
+	uint8_t *host;
+	int i;
+
+	if (address >= MEM_KTEXT_BEGIN) {
+		return NULL;
+	}
+	i = tlb_find(hi);
+	if (i >= 0) {
+		lo = TLB[i].lo;
+	} else {
+		lo = mem_read_32((CP0[CP0_CONTEXT] & CONTEXT_PTEBASE) | ((address >> MMU_PAGE_BITS) << 2));
+	}
+	if (!(lo & ENTRYLO_V) || (write && !(lo & ENTRYLO_D))) {
+		return NULL;
+	}
+	host = mem_host_ptr((lo & ENTRYLO_PFN) | (address & (MMU_PAGE_SIZE - 1)), avail);
+	if (host != NULL && *avail > left) {
+		*avail = left;
+	}
+	return host;
+}
+
+/***************************************************************/
+/* Finish the cycle an exception cut short: the instruction    */
+/* does not retire, the kernel handler runs next               */
+/***************************************************************/
+void mmu_fault() {
+	MMU_FAULTED = TRUE;
+	CURRENT_STATE.PC = fault_vector;
+}
+
+/***************************************************************/
+/* MFC0/MTC0                                                   */
+/***************************************************************/
+uint32_t mmu_cp0_read(int reg) {
+	if (reg == CP0_RANDOM) {
+		return random_index() << 8;
+	}
+	if (reg == CP0_COUNT) {
+		return INSTRUCTION_COUNT + count_offset;
+	}
+	return CP0[reg];
+}
+
+void mmu_cp0_write(int reg, uint32_t value) {
+	switch (reg) {
+	case CP0_ENTRYHI:
+		if ((value ^ CP0[CP0_ENTRYHI]) & ENTRYHI_ASID) {
+			mmu_flush_host();
+		}
+		CP0[reg] = value & (ENTRYHI_VPN | ENTRYHI_ASID);
+		break;
+	case CP0_CONTEXT:
+		CP0[reg] = (value & CONTEXT_PTEBASE) | (CP0[reg] & ~CONTEXT_PTEBASE);
+		break;
+	case CP0_COUNT:
+		count_offset = value - INSTRUCTION_COUNT;
+		TIMER_DUE = CP0[CP0_COMPARE] - count_offset;
+		break;
+	case CP0_COMPARE:
+		/* writing Compare acknowledges the timer interrupt */
+		CP0[reg] = value;
+		CP0[CP0_CAUSE] &= ~CAUSE_IP_TIMER;
+		TIMER_DUE = value - count_offset;
+		timer_armed = TRUE;
+		break;
+	case CP0_CAUSE:
+		/* only the software interrupt bits are writable */
+		CP0[reg] = (CP0[reg] & ~0x300) | (value & 0x300);
+		break;
+	case CP0_RANDOM:
+	case CP0_BADVADDR:
+		break;	/* read-only */
+	default:
+		CP0[reg] = value;
+		break;
+	}
+}
+
+/***************************************************************/
+/* TLBR, TLBWI/TLBWR and TLBP                                  */
+/***************************************************************/
+void mmu_tlb_read() {
+	int i = (CP0[CP0_INDEX] >> 8) % CFG.tlb_entries;
+
+	mmu_cp0_write(CP0_ENTRYHI, TLB[i].hi);
+	CP0[CP0_ENTRYLO] = TLB[i].lo;
+}
+
+void mmu_tlb_write(int random) {
+	tlb_set(random ? random_index() : (CP0[CP0_INDEX] >> 8) % CFG.tlb_entries,
+		CP0[CP0_ENTRYHI], CP0[CP0_ENTRYLO]);
+}
+
+void mmu_tlb_probe() {
+	int i = tlb_find(CP0[CP0_ENTRYHI]);
+
+	CP0[CP0_INDEX] = i < 0 ? INDEX_P : (uint32_t)i << 8;
+}
+
+/***************************************************************/
+/* ERET: leave the handler, back to EPC in user mode           */
+/***************************************************************/
+uint32_t mmu_eret() {
+	CP0[CP0_STATUS] &= ~STATUS_EXL;
+	return CP0[CP0_EPC];
+}
+
+/***************************************************************/
+/* Print TLB hit rates and exception counts                    */
+/***************************************************************/
+void mmu_report() {
+	uint64_t hits = MMU.host_hits + MMU.lookups - MMU.misses;
+	uint64_t total = MMU.host_hits + MMU.lookups;
+	int i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("MMU: %d TLB entries, %s refill, page table at 0x%08x\n", CFG.tlb_entries,
+		CFG.hw_walk ? "hardware" : "software", CP0[CP0_CONTEXT] & CONTEXT_PTEBASE);
+	printf("-------------------------------------------------------------\n");
+	printf("Translations\t\t: %llu\n", (unsigned long long)total);
+	if (total == 0) {
+		printf("\n");
+		return;
+	}
+	printf("TLB hits\t\t: %llu (%.2f%%)\n", (unsigned long long)hits, 100.0 * hits / total);
+	printf("TLB misses\t\t: %llu (%.2f%%)\n", (unsigned long long)MMU.misses, 100.0 * MMU.misses / total);
+	if (CFG.hw_walk) {
+		printf("Hardware refills\t: %llu\n", (unsigned long long)MMU.walks);
+	}
+	printf("Host cache hits\t\t: %llu (%.2f%%)\n", (unsigned long long)MMU.host_hits,
+		100.0 * MMU.host_hits / total);
+	for (i = 0; i < NUM_EXC; i++) {
+		if (MMU.exceptions[i] > 0) {
+			printf("%s exceptions\t\t: %llu\n", EXC_NAMES[i], (unsigned long long)MMU.exceptions[i]);
+		}
+	}
+	printf("\n");
+}
@@ -0,0 +1,155 @@
+#ifndef MMU_H
+#define MMU_H
+
+#include <stdint.h>
+#include <setjmp.h>
+#include "mu-mips.h"
+
+/******************************************************************************/
+/* Optional guest virtual memory: an R3000-style TLB managed by a kernel      */
+/* loaded at MEM_KTEXT_BEGIN, or refilled by a hardware page table walker     */
+/*                                                                            */
+/* User addresses (below MEM_KTEXT_BEGIN) go through the TLB; kernel          */
+/* addresses are unmapped and only usable in kernel mode (Status.EXL set).    */
+/* Physical addresses are the flat MEM_REGIONS space that mdump, mload and    */
+/* the rest of the monitor keep using.                                        */
+/******************************************************************************/
+#define MMU_PAGE_BITS 12
+#define MMU_PAGE_SIZE (1 << MMU_PAGE_BITS)
+#define MMU_MAX_TLB   64	/* fits Index/Random bits 13..8 */
+#define MMU_WIRED     8		/* low entries TLBWR never replaces */
+#define MMU_HOST_ENTRIES 1024	/* host translation cache, direct mapped by VPN */
+
+/* kernel entry points */
+#define MMU_REFILL_VECTOR  MEM_KTEXT_BEGIN			/* TLB miss on a user address */
+#define MMU_GENERAL_VECTOR (MEM_KTEXT_BEGIN + 0x080)	/* everything else */
+#define MMU_BOOT_VECTOR    (MEM_KTEXT_BEGIN + 0x200)	/* first instruction after load/reset */
+
+/* coprocessor 0 registers (R3000 numbering) */
+#define CP0_INDEX    0
+#define CP0_RANDOM   1
+#define CP0_ENTRYLO  2
+#define CP0_CONTEXT  4
+#define CP0_BADVADDR 8
+#define CP0_COUNT    9		/* counts retired instructions */
+#define CP0_ENTRYHI  10
+#define CP0_COMPARE  11		/* the timer interrupt fires when Count reaches it */
+#define CP0_STATUS   12
+#define CP0_CAUSE    13
+#define CP0_EPC      14
+#define NUM_CP0_REGS 32
+
+#define ENTRYHI_VPN  0xFFFFF000
+#define ENTRYHI_ASID 0x00000FC0
+#define ENTRYLO_PFN  0xFFFFF000
+#define ENTRYLO_D    0x00000400	/* writable */
+#define ENTRYLO_V    0x00000200	/* valid */
+#define ENTRYLO_G    0x00000100	/* global: matches any ASID */
+#define INDEX_P      0x80000000	/* TLBP found no match */
+#define CONTEXT_PTEBASE 0xFFE00000
+#define STATUS_IE    0x00000001	/* interrupts enabled (while EXL is clear) */
+#define STATUS_EXL   0x00000002	/* exception level: kernel mode, refills go to the general vector */
+#define CAUSE_IP     0x0000FF00	/* pending interrupts; Status.IM masks them at the same bits */
+#define CAUSE_IP_TIMER 0x00008000	/* IP7, the Count/Compare timer */
+
+/* Cause.ExcCode values */
+#define EXC_INT  0	/* interrupt */
+#define EXC_MOD  1	/* store to a clean page */
+#define EXC_TLBL 2	/* load or fetch miss/invalid */
+#define EXC_TLBS 3	/* store miss/invalid */
+#define EXC_ADEL 4	/* user load or fetch from a kernel address, or a misaligned one */
+#define EXC_ADES 5	/* user store to a kernel address, or a misaligned store */
+#define EXC_RI   10	/* reserved (unknown) instruction */
+#define EXC_OV   12	/* ADD, ADDI or SUB overflow */
+#define EXC_TR   13	/* DIV or DIVU by zero, as the trap compilers put in front of it */
+#define NUM_EXC  14
+
+enum { MMU_FETCH, MMU_LOAD, MMU_STORE };
+
+typedef struct {
+	int tlb_entries;
+	int hw_walk;		/* refill from the page table at Context instead of trapping */
+	uint32_t pt_base;	/* initial Context.PTEBase */
+} mmu_config_t;
+
+typedef struct {
+	uint32_t vpn;	/* virtual page number, MMU_NO_PAGE if empty */
+	uint8_t *host;	/* host address of the page */
+} mmu_host_t;
+
+#define MMU_NO_PAGE 0xFFFFFFFF
+
+typedef struct {
+	uint64_t host_hits;	/* translations served by the host cache */
+	uint64_t lookups, misses, walks;
+	uint64_t exceptions[NUM_EXC];
+} mmu_stats_t;
+
+extern int MMU_FLAG;		/* -m: translate guest addresses */
+extern int KERNEL_LOADED;	/* -k: a kernel owns MEM_KTEXT_BEGIN */
+extern uint32_t CP0[NUM_CP0_REGS];
+extern jmp_buf MMU_FAULT;	/* cycle() catches exceptions raised mid-instruction here */
+extern int MMU_FAULTED;		/* the instruction in flight raised an exception and does not retire */
+extern uint32_t TIMER_DUE;	/* INSTRUCTION_COUNT at which Count reaches Compare */
+
+/* cycle() only sets up MMU_FAULT when something can raise through it */
+#define MMU_TRAPS (MMU_FLAG || KERNEL_LOADED)
+extern mmu_host_t HOST_READ[MMU_HOST_ENTRIES], HOST_WRITE[MMU_HOST_ENTRIES];
+extern mmu_stats_t MMU;
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int mmu_configure(const char *spec);
+int mmu_load_kernel(const char *path);
+void mmu_reset();
+void mmu_flush_host();
+uint32_t mmu_read_slow(uint32_t address, int access);
+void mmu_write_slow(uint32_t address, uint32_t value);
+uint8_t *mmu_guest_ptr(uint32_t address, int write, uint32_t *avail);
+void mmu_fault();
+void mmu_exception(int code);
+void mmu_address_error(int code, uint32_t address);
+void mmu_timer();
+void mmu_interrupt();
+uint32_t mmu_cp0_read(int reg);
+void mmu_cp0_write(int reg, uint32_t value);
+void mmu_tlb_read();
+void mmu_tlb_write(int random);
+void mmu_tlb_probe();
+uint32_t mmu_eret();
+void mmu_report();
+
+/***************************************************************/
+/* Guest loads and stores; pages the host cache knows skip the */
+/* TLB search and the region lookup                            */
+/***************************************************************/
+static inline uint32_t mmu_read_32(uint32_t address, int access) {
+	mmu_host_t *h = &HOST_READ[(address >> MMU_PAGE_BITS) % MMU_HOST_ENTRIES];
+	uint8_t *p;
+
+	if (h->vpn != address >> MMU_PAGE_BITS) {
+		return mmu_read_slow(address, access);
+	}
+	MMU.host_hits++;
+	p = h->host + (address & (MMU_PAGE_SIZE - 1));
+	return (p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+static inline void mmu_write_32(uint32_t address, uint32_t value) {
+	mmu_host_t *h = &HOST_WRITE[(address >> MMU_PAGE_BITS) % MMU_HOST_ENTRIES];
+	uint8_t *p;
+
+	if (h->vpn != address >> MMU_PAGE_BITS) {
+		mmu_write_slow(address, value);
+		return;
+	}
+	MMU.host_hits++;
+	p = h->host + (address & (MMU_PAGE_SIZE - 1));
+	p[3] = (value >> 24) & 0xFF;
+	p[2] = (value >> 16) & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	p[0] = value & 0xFF;
+}
+
+#endif
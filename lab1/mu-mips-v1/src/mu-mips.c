@@ -3,7 +3,41 @@
 #include <string.h>
 #include <stdint.h>
 #include <assert.h>
+#include <sys/mman.h>
 #include "mu-mips.h"
+#include "syscall.h"
+#include "perfctr.h"
+#include "stats.h"
+#include "memio.h"
+#include "mmapseg.h"
+#include "ooo.h"
+#include "dram.h"
+#include "undo.h"
+#include "trace.h"
+#include "isa.h"
+#include "mmu.h"
+#include "energy.h"
+#include "image.h"
+#include "server.h"
+#include "hang.h"
+#include "prefetch.h"
+#include "slice.h"
+
+/* memory will be dynamically allocated at initialization */
+mem_region_t MEM_REGIONS[] = {
+	{ MEM_TEXT_BEGIN, MEM_TEXT_END, NULL },
+	{ MEM_DATA_BEGIN, MEM_DATA_END, NULL },
+	{ MEM_KDATA_BEGIN, MEM_KDATA_END, NULL },
+	{ MEM_KTEXT_BEGIN, MEM_KTEXT_END, NULL }
+};
+
+CPU_State CURRENT_STATE, NEXT_STATE;
+int RUN_FLAG;
+uint32_t INSTRUCTION_COUNT;
+uint32_t PROGRAM_SIZE;
+
+char prog_file[256];
+int TRACE_FLAG = TRUE;
 
 /***************************************************************/
 /* Print out a list of commands available                                                                  */
@@ -12,11 +46,22 @@ void help() {
 	printf("------------------------------------------------------------------\n\n");
 	printf("\t**********MU-MIPS Help MENU**********\n\n");
 	printf("sim\t-- simulate program to completion \n");
+	printf("stats\t-- print execution statistics as JSON\n");
 	printf("run <n>\t-- simulate program for <n> instructions\n");
+	printf("ooo\t-- print the out-of-order timing report (-o)\n");
+	printf("dram\t-- print the DRAM timing report (-d)\n");
+	printf("mmu\t-- print the TLB report (-m)\n");
+	printf("energy\t-- print the energy report (-e)\n");
+	printf("prefetch\t-- print the prefetcher report (-f)\n");
+	printf("rstep <n>\t-- step back <n> instructions (-u)\n");
+	printf("rcontinue [addr]\t-- step back until PC is <addr>, or as far as the history goes (-u)\n");
 	printf("rdump\t-- dump register values\n");
 	printf("reset\t-- clears all registers/memory and re-loads the program\n");
 	printf("input <reg> <val>\t-- set GPR <reg> to <val>\n");
 	printf("mdump <start> <stop>\t-- dump memory from <start> to <stop> address\n");
+	printf("mdump <start> <stop> <file> [bin|hex]\t-- write memory from <start> to <stop> to <file>\n");
+	printf("mload <start> <file> [bin|hex]\t-- load <file> into memory at <start>\n");
+	printf("mmap <addr> <file> [ro|cow|shared]\t-- map <file> into the data region at <addr>\n");
 	printf("high <val>\t-- set the HI register to <val>\n");
 	printf("low <val>\t-- set the LO register to <val>\n");
 	printf("print\t-- print the program loaded into memory\n");
@@ -50,6 +95,14 @@ void mem_write_32(uint32_t address, uint32_t value)
 {
 	int i;
 	uint32_t offset;
+	if (MMAP_RO_WINDOWS && mmap_read_only(address, 4)) {
+		printf("Error: store to read-only mapped file at 0x%08x, stopping simulation\n", address);
+		RUN_FLAG = FALSE;
+		return;
+	}
+	if (UNDO_OPEN) {
+		undo_save_range(address, 4);
+	}
 	for (i = 0; i < NUM_MEM_REGION; i++) {
 		if ( (address >= MEM_REGIONS[i].begin) && (address <= MEM_REGIONS[i].end) ) {
 			offset = address - MEM_REGIONS[i].begin;
@@ -62,13 +115,71 @@ void mem_write_32(uint32_t address, uint32_t value)
 	}
 }
 
+/***************************************************************/
+/* Host pointer backing a guest address; *avail gets the number of */
+/* bytes left in that region (NULL if the address is unmapped)     */
+/***************************************************************/
+uint8_t *mem_host_ptr(uint32_t address, uint32_t *avail)
+{
+	int i;
+	for (i = 0; i < NUM_MEM_REGION; i++) {
+		if ( (address >= MEM_REGIONS[i].begin) && (address <= MEM_REGIONS[i].end) ) {
+			if (avail != NULL) {
+				*avail = MEM_REGIONS[i].end - address + 1;
+			}
+			return MEM_REGIONS[i].mem + (address - MEM_REGIONS[i].begin);
+		}
+	}
+	return NULL;
+}
+
 /***************************************************************/
 /* Execute one cycle                                                                                                              */
 /***************************************************************/
 void cycle() {                                                
-	handle_instruction();
-	CURRENT_STATE = NEXT_STATE;
+	if (UNDO_FLAG) {
+		undo_begin();
+	}
+	if (!MMU_TRAPS) {
+		handle_instruction();
+	} else if (setjmp(MMU_FAULT) == 0) {
+		if (INSTRUCTION_COUNT == TIMER_DUE) {
+			mmu_timer();
+		}
+		if (CP0[CP0_CAUSE] & CP0[CP0_STATUS] & CAUSE_IP) {
+			mmu_interrupt();
+		}
+		handle_instruction();
+	} else {
+		mmu_fault();
+	}
+	if (MMU_FAULTED) {
+		/* exceptions are precise: the instruction never retired */
+		MMU_FAULTED = FALSE;
+		if (UNDO_FLAG) {
+			undo_end();
+		}
+		return;
+	}
 	INSTRUCTION_COUNT++;
+	if (UNDO_FLAG) {
+		undo_end();
+	}
+	if (OOO_FLAG) {
+		ooo_retire(&RETIRED);
+	}
+	if (DRAM_FLAG) {
+		dram_retire(&RETIRED);
+	}
+	if (PREFETCH_FLAG) {
+		prefetch_retire(&RETIRED);
+	}
+	if (ENERGY_FLAG) {
+		energy_retire(&RETIRED);
+	}
+	if (HANG_FLAG) {
+		hang_retire(&RETIRED);
+	}
 }
 
 /***************************************************************/
@@ -82,6 +193,12 @@ void run(int num_cycles) {
 	}
 
 	printf("Running simulator for %d cycles...\n\n", num_cycles);
+	if (PERF_FLAG) {
+		perf_begin();
+	}
+	if (HANG_FLAG) {
+		hang_begin();
+	}
 	int i;
 	for (i = 0; i < num_cycles; i++) {
 		if (RUN_FLAG == FALSE) {
@@ -90,6 +207,14 @@ void run(int num_cycles) {
 		}
 		cycle();
 	}
+	if (HANG_FLAG) {
+		hang_end();
+	}
+	if (PERF_FLAG) {
+		perf_end();
+	}
+	syscall_flush();
+	trace_flush(FALSE);
 }
 
 /***************************************************************/
@@ -102,10 +227,47 @@ void runAll() {
 	}
 
 	printf("Simulation Started...\n\n");
+	if (PERF_FLAG) {
+		perf_begin();
+	}
+	if (HANG_FLAG) {
+		hang_begin();
+	}
+	if (SLICE_FLAG) {
+		slice_run();
+	}
 	while (RUN_FLAG){
 		cycle();
 	}
+	if (HANG_FLAG) {
+		hang_end();
+	}
+	if (PERF_FLAG) {
+		perf_end();
+	}
+	syscall_flush();
+	trace_flush(FALSE);
 	printf("Simulation Finished.\n\n");
+	if (SLICE_FLAG) {
+		/* the timing models ran in the slice workers */
+		slice_report();
+		return;
+	}
+	if (OOO_FLAG) {
+		ooo_report();
+	}
+	if (DRAM_FLAG) {
+		dram_report();
+	}
+	if (MMU_FLAG) {
+		mmu_report();
+	}
+	if (PREFETCH_FLAG) {
+		prefetch_report();
+	}
+	if (ENERGY_FLAG) {
+		energy_report();
+	}
 }
 
 /***************************************************************/ 
@@ -155,24 +317,80 @@ void handle_command() {
 	uint32_t register_no;
 	int register_value;
 	int hi_reg_value, lo_reg_value;
+	char path[256], format[8], rest[300];
 
 	printf("MU-MIPS SIM:> ");
 
 	if (scanf("%s", returnString) == EOF){
+		syscall_flush();
+		trace_flush(TRUE);
+		mmap_sync(TRUE);
 		exit(0);
 	}
 
 	switch(returnString[0]) {
 		case 'S':
 		case 's':
+			if (strcmp(returnString, "stats") == 0) {
+				char json[1024];
+				stats_json(json, sizeof(json));
+				printf("%s\n", json);
+				break;
+			}
 			runAll(); 
 			break;
 		case 'M':
 		case 'm':
+			if (strcmp(returnString, "mmu") == 0) {
+				if (!MMU_FLAG) {
+					printf("Address translation is off (start with -m <config>)\n\n");
+					break;
+				}
+				mmu_report();
+				break;
+			}
+			if (strcmp(returnString, "mmap") == 0) {
+				path[0] = format[0] = '\0';
+				if (fgets(rest, sizeof(rest), stdin) == NULL
+					|| sscanf(rest, "%x %255s %7s", &start, path, format) < 2) {
+					mmap_list();
+					break;
+				}
+				if (mmap_mode(format) < 0) {
+					printf("Invalid mode %s (use ro, cow or shared)\n", format);
+					break;
+				}
+				mmap_file(start, path, mmap_mode(format));
+				break;
+			}
+			if (strcmp(returnString, "mload") == 0) {
+				if (scanf("%x %255s", &start, path) != 2 || fgets(rest, sizeof(rest), stdin) == NULL) {
+					break;
+				}
+				format[0] = '\0';
+				sscanf(rest, "%7s", format);
+				if (memio_format(format) < 0) {
+					printf("Invalid format %s (use bin or hex)\n", format);
+					break;
+				}
+				mload_file(start, path, memio_format(format));
+				break;
+			}
 			if (scanf("%x %x", &start, &stop) != 2){
 				break;
 			}
-			mdump(start, stop);
+			/* optional "<file> [bin|hex]" streams the range to a file */
+			path[0] = format[0] = '\0';
+			if (fgets(rest, sizeof(rest), stdin) != NULL) {
+				sscanf(rest, "%255s %7s", path, format);
+			}
+			if (path[0] == '\0') {
+				mdump(start, stop);
+			} else if (memio_format(format) < 0) {
+				printf("Invalid format %s (use bin or hex)\n", format);
+			} else {
+				mdump_file(start, stop, path, memio_format(format));
+			}
 			break;
 		case '?':
 			help();
@@ -182,10 +400,30 @@ void handle_command() {
 			printf("**************************\n");
 			printf("Exiting MU-MIPS! Good Bye...\n");
 			printf("**************************\n");
+			syscall_flush();
+			trace_flush(TRUE);
+			mmap_sync(TRUE);
 			exit(0);
 		case 'R':
 		case 'r':
-			if (returnString[1] == 'd' || returnString[1] == 'D'){
+			if (strcmp(returnString, "rstep") == 0 || strcmp(returnString, "rcontinue") == 0) {
+				if (!UNDO_FLAG) {
+					printf("Reverse execution is off (start with -u <MiB>)\n\n");
+					fgets(rest, sizeof(rest), stdin);
+				} else if (returnString[1] == 's') {
+					if (scanf("%u", &cycles) == 1) {
+						undo_step_back(cycles);
+					}
+				} else {
+					rest[0] = '\0';
+					fgets(rest, sizeof(rest), stdin);
+					if (sscanf(rest, "%x", &start) == 1) {
+						undo_continue_back(TRUE, start);
+					} else {
+						undo_continue_back(FALSE, 0);
+					}
+				}
+			} else if (returnString[1] == 'd' || returnString[1] == 'D'){
 				rdump();
 			}else if(returnString[1] == 'e' || returnString[1] == 'E'){
 				reset();
@@ -221,8 +459,50 @@ void handle_command() {
 			CURRENT_STATE.LO = lo_reg_value;
 			NEXT_STATE.LO = lo_reg_value;
 			break;
+		case 'D':
+		case 'd':
+			if (!DRAM_FLAG) {
+				printf("DRAM timing is off (start with -d <config>)\n\n");
+				break;
+			}
+			if (slice_has_results()) {
+				printf("The last run was timed in slices, see its report:\n");
+				slice_report();
+				break;
+			}
+			dram_report();
+			break;
+		case 'E':
+		case 'e':
+			if (!ENERGY_FLAG) {
+				printf("Energy accounting is off (start with -e <config>)\n\n");
+				break;
+			}
+			energy_report();
+			break;
+		case 'O':
+		case 'o':
+			if (!OOO_FLAG) {
+				printf("Out-of-order timing is off (start with -o <config>)\n\n");
+				break;
+			}
+			if (slice_has_results()) {
+				printf("The last run was timed in slices, see its report:\n");
+				slice_report();
+				break;
+			}
+			ooo_report();
+			break;
 		case 'P':
 		case 'p':
+			if (strcmp(returnString, "prefetch") == 0) {
+				if (!PREFETCH_FLAG) {
+					printf("Prefetch models are off (start with -f <config>)\n\n");
+					break;
+				}
+				prefetch_report();
+				break;
+			}
 			print_program(); 
 			break;
 		default:
@@ -243,17 +523,30 @@ void reset() {
 	CURRENT_STATE.HI = 0;
 	CURRENT_STATE.LO = 0;
 	
+	/* dropping the pages zeroes anonymous memory, reverts copy-on-write
+	   file windows and leaves shared file windows to their files */
+	mmap_sync(TRUE);
 	for (i = 0; i < NUM_MEM_REGION; i++) {
 		uint32_t region_size = MEM_REGIONS[i].end - MEM_REGIONS[i].begin + 1;
-		memset(MEM_REGIONS[i].mem, 0, region_size);
+		madvise(MEM_REGIONS[i].mem, region_size, MADV_DONTNEED);
 	}
 	
 	/*load program*/
 	load_program();
+	syscall_reset();
 	
 	/*reset PC*/
 	INSTRUCTION_COUNT = 0;
-	CURRENT_STATE.PC =  MEM_TEXT_BEGIN;
+	stats_reset();
+	ooo_reset();
+	dram_reset();
+	prefetch_reset();
+	energy_reset();
+	hang_reset();
+	undo_reset();
+	slice_reset();
+	mmu_reset();
+	CURRENT_STATE.PC = KERNEL_LOADED ? MMU_BOOT_VECTOR : MEM_TEXT_BEGIN;
 	NEXT_STATE = CURRENT_STATE;
 	RUN_FLAG = TRUE;
 }
@@ -265,8 +558,13 @@ void init_memory() {
 	int i;
 	for (i = 0; i < NUM_MEM_REGION; i++) {
 		uint32_t region_size = MEM_REGIONS[i].end - MEM_REGIONS[i].begin + 1;
-		MEM_REGIONS[i].mem = malloc(region_size);
-		memset(MEM_REGIONS[i].mem, 0, region_size);
+		/* page-aligned and zero-filled on demand, so files can be mapped over it */
+		MEM_REGIONS[i].mem = mmap(NULL, region_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (MEM_REGIONS[i].mem == MAP_FAILED) {
+			printf("Error: Can't allocate memory region 0x%08x..0x%08x\n", MEM_REGIONS[i].begin, MEM_REGIONS[i].end);
+			exit(-1);
+		}
 	}
 }
 
@@ -278,6 +576,12 @@ void load_program() {
 	int i, word;
 	uint32_t address;
 
+	/* a cached image of the same file skips parsing */
+	image_release_text();
+	if (IMAGE_CACHE_DIR != NULL && image_load_cached(prog_file)) {
+		return;
+	}
+
 	/* Open program file. */
 	fp = fopen(prog_file, "r");
 	if (fp == NULL) {
@@ -291,12 +595,18 @@ void load_program() {
 	while( fscanf(fp, "%x\n", &word) != EOF ) {
 		address = MEM_TEXT_BEGIN + i;
 		mem_write_32(address, word);
-		printf("writing 0x%08x into address 0x%08x (%d)\n", word, address, address);
+		if (TRACE_FLAG) {
+			printf("writing 0x%08x into address 0x%08x (%d)\n", word, address, address);
+		}
 		i += 4;
 	}
 	PROGRAM_SIZE = i/4;
 	printf("Program loaded into memory.\n%d words written into memory.\n\n", PROGRAM_SIZE);
 	fclose(fp);
+
+	if (IMAGE_CACHE_DIR != NULL) {
+		image_store(prog_file);
+	}
 }
 
 /************************************************************/
@@ -304,400 +614,35 @@ void load_program() {
 /************************************************************/
 void handle_instruction()
 {
-	// Incrementing address by instructNum bytes to get the right addresss
-	// uint32_t addr = baseInstruction + (instructionNum * 4);
-
-	// Reading Instruction and Relevant Masks
-	uint32_t instruction = mem_read_32(CURRENT_STATE.PC); 			// Get the 32-bit instruction from memory
-	uint32_t specialMask = 0xFC000000; 					// Mask for bits 26-31
-	uint32_t rsMask = 0x03E00000; 						// Mask for bits 21-25
-	uint32_t rtMask = 0x001F0000; 						// Mask for bits 16-20
-	uint32_t rdMask = 0x0000F800;						// Mask for bits 11-15
-	uint32_t functMask = 0x0000003F;					// Mask for bits 1 - 6
-	uint32_t immediateMask = 0x0000FFFF; 				// Mask for bits 0 -16
-	uint32_t targetMask = 0x03FFFFFF; 					// Mask for bits  0-26
-	uint32_t saMask = 0x000007C0; 						// Mask for bits  6-20
-
-	// Variables for R-Type Instructions
-	uint32_t special 	= (instruction & specialMask) 	>> 26; 	// Shifting to get correct digits
-	uint32_t rs 		= (instruction & rsMask)  		>> 21;
-	uint32_t rt 		= (instruction & rtMask)  		>> 16;
-	uint32_t rd 		= (instruction & rdMask)  		>> 11;
-	uint32_t function 	= instruction & functMask;
-	uint32_t sa 		= (instruction & saMask)		>>  6;
-
-	// Variables for I-Type Instructions
-	uint32_t immediate 	= instruction & immediateMask;
-
-	// Variables for J-Type Instructions
-	uint32_t target 	= instruction & targetMask;
-
-	// Variables needed for operation
-	char returnString[40];
-	uint32_t value, value2, location, temp;
-	int jumpAmmount = 4;
-	uint32_t offset = immediate;
-
-	uint32_t base = rs;
-
-	switch (special)
-	{
-	// Special case code
-	case 0b000000:
-		switch (function)
-		{
-		case 0b100000: //ADD instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] + CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "ADD $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100001: //ADDU instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] + CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "ADDU $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100010: //SUB instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] - CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "SUB $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100011: //SUBU instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] - CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "SUBU $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b011000: //MULT instruction
-			temp = CURRENT_STATE.REGS[rs] * CURRENT_STATE.REGS[rt];
-			NEXT_STATE.HI = temp >> 32;
-			NEXT_STATE.LO = temp & 0xFFFFFFFF;
-			sprintf(returnString, "MULT $r%d, $r%d\n", rs, rt);
-			break;
-				
-		case 0b011001:{ //MULTU instruction
-			temp = CURRENT_STATE.REGS[rs] * CURRENT_STATE.REGS[rt];
-			NEXT_STATE.HI = temp >> 32;
-			NEXT_STATE.LO = temp & 0xFFFFFFFF;
-			sprintf(returnString, "MULTU $r%d, $r%d\n", rs, rt);
-			}
-			break;
-				
-		case 0b011010: //DIV instruction
-			NEXT_STATE.HI = CURRENT_STATE.REGS[rs] % CURRENT_STATE.REGS[rt];
-			NEXT_STATE.LO = CURRENT_STATE.REGS[rs] / CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "DIV $r%d, $r%d\n", rs, rt);
-			break;
-				
-		case 0b011011: //DIVU instruction
-			NEXT_STATE.HI = CURRENT_STATE.REGS[rs] % CURRENT_STATE.REGS[rt];
-			NEXT_STATE.LO = CURRENT_STATE.REGS[rs] / CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "DIVU $r%d, $r%d\n", rs, rt);
-			break;
-				
-		case 0b100100: //AND instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] & CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "AND $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100101: //OR instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] | CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "OR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100110: //XOR instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rs] ^ CURRENT_STATE.REGS[rt];
-			sprintf(returnString, "XOR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b100111: //NOR instruction
-			NEXT_STATE.REGS[rd] = ~ (CURRENT_STATE.REGS[rs] | CURRENT_STATE.REGS[rt]);
-			sprintf(returnString, "NOR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b101010: //SLT instruction
-			if(CURRENT_STATE.REGS[rs] < CURRENT_STATE.REGS[rt])
-			{
-                		NEXT_STATE.REGS[rd] = 0x01;
-			}
-            		else
-			{
-                		NEXT_STATE.REGS[rd] = 0x00;
-            		}
-			sprintf(returnString, "SLT $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-				
-		case 0b000000: //SLL instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rt] << sa;
-			sprintf(returnString, "SLL $r%d, $r%d, 0x%x\n", rd, rt, sa);
-			break;
-				
-		case 0b000010: //SRL instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rt] >> sa;
-			sprintf(returnString, "SRL $r%d, $r%d, 0x%x\n", rd, rt, sa);
-			break;
-				
-		case 0b000011: //SRA instruction
-			if(CURRENT_STATE.REGS[rt] >> 31)
-			{
-				NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rt] >> sa;
-				NEXT_STATE.REGS[rd] |= 0x80000000;
-			}
-			else
-			{
-				NEXT_STATE.REGS[rd] = CURRENT_STATE.REGS[rt] >> sa;
-			}
-			sprintf(returnString, "SRA $r%d, $r%d, 0x%x\n", rd, rt, sa);
-			break;
-				
-		case 0b010000: //MFHI instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.HI;
-			sprintf(returnString, "MFHI $r%d\n", rd);
-			break;
-				
-		case 0b010010: //MFLO instruction
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.LO;
-			sprintf(returnString, "MFLO $r%d\n", rd);
-			break;
-
-		case 0b010001:
-			sprintf(returnString, "MTHI $r%d\n", rs);
-			NEXT_STATE.HI = CURRENT_STATE.REGS[rs];
-			break;
-
-		case 0b010011:
-			sprintf(returnString, "MTLO $r%d\n", rs);
-			NEXT_STATE.LO = CURRENT_STATE.REGS[rs];
-			break;
-
-		case 0b001000:
-			sprintf(returnString, "JR $r%d\n", rs);
-			temp = CURRENT_STATE.REGS[rs];
-			jumpAmmount = temp - CURRENT_STATE.PC;
-			break;
-
-		case 0b001001:
-			sprintf(returnString, "JALR $r%d, $r%d\n", rd, rs);
-			temp = CURRENT_STATE.REGS[rs];
-			NEXT_STATE.REGS[rd] = CURRENT_STATE.PC + 4;
-			jumpAmmount = temp - CURRENT_STATE.PC;
-			break;
-
-		case 0b001100:
-			sprintf(returnString, "SYSCALL\n");
-			RUN_FLAG = FALSE;
-			break;
-
-		default:
-			printf("No Special Instruction Found\n");
-			break;
-		}
-		break;
-	
-	// Register case code
-	case 0b000110:
-		offset = offset << 2;
-		sprintf(returnString, "BLEZ $r%d, 0x%x\n", rs, offset);
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		if(((CURRENT_STATE.REGS[rs] & 0x80000000)>>31) || (CURRENT_STATE.REGS[rs] == 0x00)){
-			jumpAmmount = offset;
-		}
-		break;
-
-	case 0b000001:
-		switch (rt){
-		case 0b00000:
-			offset = offset << 2;
-			sprintf(returnString, "BLTZ $r%d, 0x%x\n", rs, offset);
-			// sign extend (check if most significant bit is a 1)
-			if(((offset & 0x00008000)>>15)){
-				offset = offset | 0xFFFF0000;
-			}
-			if(((CURRENT_STATE.REGS[rs] & 0x80000000)>>31) == 0x1){
-				jumpAmmount = offset; // changed
-			}
-			break;
-
-		case 0b00001:
-			offset = offset << 2;
-			sprintf(returnString, "BGEZ $r%d, 0x%x\n", rs, offset);
-			// Do a sign extenstion only if the most signifcant bit is a 1
-			if(((offset & 0x00008000)>>15)){
-				offset = offset | 0xFFFF0000;
-			}
-			if(((CURRENT_STATE.REGS[rs] & 0x80000000)>>31) == 0x0 ){
-				jumpAmmount = offset;
-			}
-			break;
+	if (KERNEL_LOADED && (CURRENT_STATE.PC & 3)) {
+		mmu_address_error(EXC_ADEL, CURRENT_STATE.PC);	/* does not return */
+	}
+	uint32_t instruction = MMU_FLAG ? mmu_read_32(CURRENT_STATE.PC, MMU_FETCH) : mem_read_32(CURRENT_STATE.PC);
+	int op = isa_decode(instruction);
+	int iclass = ISA_INFO[op].iclass;
+	int jumpAmmount = ISA_EXEC[op](instruction);	/* semantics live in isa.def */
 
-		default:
-			printf("No Register Type Instruction Found\n");
-			break;
+	if (jumpAmmount == 0 && MMU_FAULTED) {
+		return;		/* trapped with nothing to catch it, see mmu_exception() */
 	}
-	break;
 
-	case 0b000111:
-		offset = offset << 2;
-		sprintf(returnString, "BGTZ $r%d, 0x%x\n", rs, offset);
-		// Do a sign extenstion only if the most signifcant bit is a 1
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		if(((CURRENT_STATE.REGS[rs] & 0x80000000)>>31) == 0x0 && (CURRENT_STATE.REGS[rs] != 0x00)){
-			jumpAmmount = offset;
-		}
-		break;
-
-	// Normal case code
-	case 0b001000:
-		sprintf(returnString, "ADDI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		value = (immediate & 0x00008000) == 0x8000 ? 0xFFFF0000 | immediate : immediate;
-		NEXT_STATE.REGS[rt] = CURRENT_STATE.REGS[rs] + value;
-		break;
-
-	case 0b001001:
-		sprintf(returnString, "ADDIU $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		value = (immediate & 0x00008000) == 0x8000 ? 0xFFFF0000 | immediate : immediate;
-		NEXT_STATE.REGS[rt] = CURRENT_STATE.REGS[rs] + value;
-		break;
-
-	case 0b001100:
-		sprintf(returnString, "ANDI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		NEXT_STATE.REGS[rt] = CURRENT_STATE.REGS[rs] & immediate;
-		break;
-
-	case 0b001101:
-		sprintf(returnString, "ORI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		NEXT_STATE.REGS[rt] = CURRENT_STATE.REGS[rs] | immediate;
-		break;
-
-	case 0b001110:
-		sprintf(returnString, "XORI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		NEXT_STATE.REGS[rt] = CURRENT_STATE.REGS[rs] ^ immediate;
-		break;
-
-	case 0b001010:
-		sprintf(returnString, "SLTI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		// Do a sign extenstion only if the most signifcant bit is a 1
-		if(((immediate & 0x00008000)>>15)){
-			immediate = immediate | 0xFFFF0000;
-		}
-		if(CURRENT_STATE.REGS[rs] < immediate){
-			NEXT_STATE.REGS[rt] = 0x01;
-		}
-		else{
-			NEXT_STATE.REGS[rt] = 0x00;
-		}
-		break;
-
-	case 0b100011:
-		sprintf(returnString, "LW $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		offset = (offset & 0x00008000) == 0x8000 ? 0xFFFF0000 | offset : offset;
-		offset = CURRENT_STATE.REGS[base] + offset;
-		NEXT_STATE.REGS[rt] = mem_read_32(offset);
-		break;
-
-	case 0b100000:
-		sprintf(returnString, "LB $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		offset = (offset & 0x00008000) == 0x8000 ? 0xFFFF0000 | offset : offset;
-		value = CURRENT_STATE.REGS[base] + offset;
-		value2 = mem_read_32(value) & 0x000000FF;
-		value2 = (value2 & 0x00000080) == 0x80 ? 0xFFFFFF00 | value2 : value2;
-		NEXT_STATE.REGS[rt] = value2;
-		break;
-
-	case 0b100001:
-		sprintf(returnString, "LH $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		offset = (offset & 0x00008000) == 0x8000 ? 0xFFFF0000 | offset : offset;
-		value = CURRENT_STATE.REGS[base] + offset;
-		value2 = mem_read_32(value) & 0x0000FFFF;
-		value2 = (value2 & 0x00008000) == 0x8000 ? 0xFFFF0000 | value2 : value2;
-		NEXT_STATE.REGS[rt] = value2;	
-		break;
-
-	case 0b001111:
-		sprintf(returnString, "LUI $r%d, 0x%x\n", rt, immediate);
-		NEXT_STATE.REGS[rt] = (immediate << 16);
-		break;
-
-	case 0b101011:
-		sprintf(returnString, "SW $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		location = CURRENT_STATE.REGS[base] + offset;
-		value = CURRENT_STATE.REGS[rt];
-		mem_write_32(location, value);
-		break;
-
-	case 0b101000:
-		sprintf(returnString, "SB $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		value = CURRENT_STATE.REGS[base] + offset;
-		mem_write_32(value, CURRENT_STATE.REGS[rt] & 0x000000FF);
-		break;
-
-	case 0b101001:
-		sprintf(returnString, "SH $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		offset = (offset & 0x00008000) == 0x8000 ? 0xFFFF0000 | offset : offset;
-		value = CURRENT_STATE.REGS[base] + offset;
-		mem_write_32(value, CURRENT_STATE.REGS[rt] & 0x0000FFFF);
-		break;
-
-	case 0b000100:
-		offset = offset << 2;
-		sprintf(returnString, "BEQ $r%d, $r%d, 0x%x\n", rs, rt, offset);
-		// Do a sign extenstion only if the most signifcant bit is a 1
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		if(CURRENT_STATE.REGS[rs] == CURRENT_STATE.REGS[rt]){
-			printf("%x\n", CURRENT_STATE.PC + offset);
+	if (TRACE_FLAG) {
+		char line[TRACE_LINE_MAX];
+		fwrite(line, 1, trace_format(CURRENT_STATE.PC, instruction, line), stdout);
+	}
+	if (TRACE_ASYNC) {
+		trace_instruction(CURRENT_STATE.PC, instruction);
+	}
 
-			// CHANGED THIS
-			jumpAmmount = offset;
-		}
-		break;
+	if (iclass == CLASS_BRANCH_NOT_TAKEN && jumpAmmount != 4) {
+		iclass = CLASS_BRANCH_TAKEN;
+	}
+	STATS.by_class[iclass]++;
+	RETIRED.pc = CURRENT_STATE.PC;
+	RETIRED.instruction = instruction;
+	RETIRED.iclass = iclass;
 
-	case 0b000101:
-		offset = offset << 2;
-		sprintf(returnString, "BNE $r%d, $r%d, 0x%x\n", rs, rt, offset);
-		if(((offset & 0x00008000)>>15)){
-			offset = offset | 0xFFFF0000;
-		}
-		if(CURRENT_STATE.REGS[rs] != CURRENT_STATE.REGS[rt]){
-			jumpAmmount = offset;
-		}
-		break;
-
-	case 0b000010:
-		sprintf(returnString, "J %lu\n", (size_t)(target) << 2);
-		target = target << 2;
-		temp = 0xF0000000 & CURRENT_STATE.PC;
-		jumpAmmount = (target | temp);// - CURRENT_STATE.PC;
-		immediate = jumpAmmount - CURRENT_STATE.PC;
-		jumpAmmount = immediate;
-		NEXT_STATE.PC = (CURRENT_STATE.PC & 0xF0000000) || target;
-		break;
-
-	case 0b000011:
-		sprintf(returnString, "JAL %lu\n", (size_t)(target) << 2);
-		target = target << 2;
-		temp = target;
-		NEXT_STATE.REGS[31] = CURRENT_STATE.PC + 4;
-		jumpAmmount = temp - CURRENT_STATE.PC;
-		break;
-
-	default:
-		printf("No Normal Type Instruction Found\n");
-		break;
-	}
-	printf("[%x]\t", CURRENT_STATE.PC);
-	printf("%s", returnString);
-
-	NEXT_STATE.PC = CURRENT_STATE.PC + jumpAmmount;
+	CURRENT_STATE.PC = CURRENT_STATE.PC + jumpAmmount;
 }
 
 
@@ -707,7 +652,8 @@ void handle_instruction()
 void initialize() { 
 	init_memory();
 	CURRENT_STATE.PC = MEM_TEXT_BEGIN;
-	NEXT_STATE = CURRENT_STATE;
+	syscall_reset();
+	mmu_reset();
 	RUN_FLAG = TRUE;
 }
 
@@ -729,209 +675,10 @@ void print_program(){
 /* Print the instruction at given memory address (in MIPS assembly format)    */
 /************************************************************/
 void print_instruction(uint32_t addr){
-	/*
-	Program Must Contain These Instructions -
-	ALU Instructions: 
-	ADD, ADDU, ADDI, ADDIU, SUB, SUBU, MULT, MULTU, DIV, DIVU, AND, ANDI, OR, ORI, XOR, XORI, NOR, SLT, SLTI, SLL, SRL, SRA
-	
-	Load/Store Instructions: 
-	LW, LB, LH, LUI, SW, SB, SH, MFHI, MFLO, MTHI, MTLO
-	
-	Control Flow Instructions: 
-	BEQ, BNE, BLEZ, BLTZ, BGEZ, BGTZ, J, JR, JAL, JALR
-	
-	System Call: 
-	SYSCALL (you should implement it to exit the program. To exit the program, the value of 10 (0xA in hex) should be in $v0 when SYSCALL is executed.
-	*/
-
-	// Reading Instruction and Relevant Masks
-	uint32_t instruction = mem_read_32(addr); 			// Get the 32-bit instruction from memory
-	uint32_t specialMask = 0xFC000000; 					// Mask for bits 26-31
-	uint32_t rsMask = 0x03E00000; 						// Mask for bits 21-25
-	uint32_t rtMask = 0x001F0000; 						// Mask for bits 16-20
-	uint32_t rdMask = 0x0000F800;						// Mask for bits 11-15
-	uint32_t functMask = 0x0000003F;					// Mask for bits 1 - 6
-	uint32_t immediateMask = 0x0000FFFF; 				// Mask for bits 0 -16
-	uint32_t targetMask = 0x03FFFFFF; 					// Mask for bits  0-26
-	uint32_t saMask = 0x000007C0; 						// Mask for bits  6-20
-
-	// Variables for R-Type Instructions
-	uint32_t special 	= (instruction & specialMask) 	>> 26; 	// Shifting to get correct digits
-	uint32_t rs 		= (instruction & rsMask)  		>> 21;
-	uint32_t rt 		= (instruction & rtMask)  		>> 16;
-	uint32_t rd 		= (instruction & rdMask)  		>> 11;
-	uint32_t function 	= instruction & functMask;
-	uint32_t sa 		= (instruction & saMask)		>>  6;
-
-	// Variables for I-Type Instructions
-	uint32_t immediate 	= instruction & immediateMask;
-
-	// Variables for J-Type Instructions
-	uint32_t target 	= instruction & targetMask;
-
-	char returnString[40];
-
-	switch (special)
-	{
-	// Special case code
-	case 0b000000:
-		switch (function)
-		{
-		case 0b100000:
-			sprintf(returnString, "ADD $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100001:
-			sprintf(returnString, "ADDU $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100010:
-			sprintf(returnString, "SUB $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100011:
-			sprintf(returnString, "SUBU $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b011000:
-			sprintf(returnString, "MULT $r%d, $r%d\n", rs, rt);
-			break;
-		case 0b011001:
-			sprintf(returnString, "MULTU $r%d, $rr%d\n", rs, rt);
-			break;
-		case 0b011010:
-			sprintf(returnString, "DIV $r%d, $r%d\n", rs, rt);
-			break;
-		case 0b011011:
-			sprintf(returnString, "DIVU $r%d, $r%d\n", rs, rt);
-			break;
-		case 0b100100:
-			sprintf(returnString, "AND $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100101:
-			sprintf(returnString, "OR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100110:
-			sprintf(returnString, "XOR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b100111:
-			sprintf(returnString, "NOR $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b101010:
-			sprintf(returnString, "SLT $r%d, $r%d, $r%d\n", rd, rs, rt);
-			break;
-		case 0b000000:
-			sprintf(returnString, "SLL $r%d, $r%d, 0x%x\n", rd, rt, sa);
-			break;
-		case 0b000010:
-			sprintf(returnString, "SRL $r%d, $r%d, 0x%x\n", rd, rt, sa);
-			break;
-		case 0b000011:
-			sprintf(returnString, "SRA $r%d, $r%d, 0x%d\n", rd, rt, sa);
-			break;
-		case 0b010000:
-			sprintf(returnString, "MFHI $r%d\n", rd);
-			break;
-		case 0b010010:
-			sprintf(returnString, "MFLO $r%d\n", rd);
-			break;
-		case 0b010001:
-			sprintf(returnString, "MTHI $r%d\n", rs);
-			break;
-		case 0b010011:
-			sprintf(returnString, "MTLO $r%d\n", rs);
-			break;
-		case 0b001000:
-			sprintf(returnString, "JR $r%d\n", rs);
-			break;
-		case 0b001001:
-			sprintf(returnString, "JALR $r%d, $r%d\n", rd, rs);
-			break;
-		case 0b001100:
-			sprintf(returnString, "SYSCALL\n");
-			break;
-		default:
-			printf("No Special Instruction Found\n");
-			break;
-		}
-		break;
-	
-	// Register case code
-	case 0b000110:
-		sprintf(returnString, "BLEZ $r%d, 0x%x\n", rs, immediate);
-		break;
-	case 0b000001:
-		switch (rt){
-		case 0b00000:
-			sprintf(returnString, "BLTZ $r%d, 0x%x\n", rs, immediate);
-			break;
-		case 0b00001:
-			sprintf(returnString, "BGEZ $r%d, 0x%x\n", rs, immediate);
-			break;
-		default:
-			printf("No Register Type Instruction Found\n");
-			break;
-	}
-	case 0b000111:
-		sprintf(returnString, "BGTZ $r%d, 0x%x\n", rs, immediate);
-		break;
-
-	// Normal case code
-	case 0b001000:
-		sprintf(returnString, "ADDI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b001001:
-		sprintf(returnString, "ADDIU $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b001100:
-		sprintf(returnString, "ANDI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b001101:
-		sprintf(returnString, "ORI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b001110:
-		sprintf(returnString, "XORI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b001010:
-		sprintf(returnString, "SLTI $r%d, $r%d, 0x%x\n", rt, rs, immediate);
-		break;
-	case 0b100011:
-		sprintf(returnString, "LW $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b100000:
-		sprintf(returnString, "LB $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b100001:
-		sprintf(returnString, "LH $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b001111:
-		sprintf(returnString, "LUI $r%d, 0x%x\n", rt, immediate);
-		break;
-	case 0b101011:
-		sprintf(returnString, "SW $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b101000:
-		sprintf(returnString, "SB $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b101001:
-		sprintf(returnString, "SH $r%d, 0x%x($r%d)\n", rt, immediate, rs);
-		break;
-	case 0b000100:
-		sprintf(returnString, "BEQ $r%d, $r%d, 0x%x\n", rs, rt, immediate);
-		break;
-	case 0b000101:
-		sprintf(returnString, "BNE $r%d, $r%d, 0x%x\n", rs, rt, immediate);
-		break;
-	case 0b000010:
-		sprintf(returnString, "J %lu\n", (size_t)(target) << 2);
-		break;
-	case 0b000011:
-		sprintf(returnString, "JAL %lu\n", (size_t)(target) << 2);
-		break;
-	
-	default:
-		printf("No Normal Type Instruction Found\n");
-		break;
-	}
+	char text[ISA_TEXT_MAX];
 
-	printf("%s", returnString);
-	
+	text[isa_disassemble(mem_read_32(addr), text)] = '\0';
+	printf("%s\n", text);
 }
 
 
@@ -940,18 +687,144 @@ void print_instruction(uint32_t addr){
 /* main                                                                                                                                   */
 /***************************************************************/
 int main(int argc, char *argv[]) {                              
+	int i;
+	char *stats_socket = NULL;
+	char *trace_path = NULL;
+	char *kernel_path = NULL;
+	char *server_path = NULL;
+	int server_workers = SERVER_DEFAULT_WORKERS;
+
 	printf("\n**************************\n");
 	printf("Welcome to MU-MIPS SIM...\n");
 	printf("**************************\n\n");
 	
-	if (argc < 2) {
-		printf("Error: You should provide input file.\nUsage: %s <input program> \n\n",  argv[0]);
+	prog_file[0] = '\0';
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-q") == 0) {
+			TRACE_FLAG = FALSE;
+		} else if (strcmp(argv[i], "-p") == 0) {
+			PERF_FLAG = TRUE;
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			stats_socket = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			if (!ooo_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+			if (!undo_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			if (!dram_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			if (!mmu_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+			if (!energy_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+			kernel_path = argv[++i];
+		} else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			IMAGE_CACHE_DIR = argv[++i];
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			if (!prefetch_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			if (!slice_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			if (!hang_configure(argv[++i])) {
+				exit(1);
+			}
+		} else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+			server_path = argv[++i];
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			server_workers = atoi(argv[++i]);
+		} else {
+			strncpy(prog_file, argv[i], sizeof(prog_file) - 1);
+		}
+	}
+
+	if (prog_file[0] == '\0' && server_path == NULL) {
+		printf("Error: You should provide input file.\nUsage: %s [-q] [-t <file>] [-p] [-s <socket>] [-o <config>] [-d <config>] [-u <MiB>] [-m <config>] [-k <kernel>] [-e <config>] [-f <config>] [-l <config>] [-c <dir>] [-w <config>] [-S <socket> [-j <n>]] <input program> \n\n",  argv[0]);
+		printf("  -q\tdo not trace instructions as they execute\n");
+		printf("  -t\twrite the instruction trace to <file> from a background thread instead\n");
+		printf("  -p\treport host performance counters after each run\n");
+		printf("  -s\tstream statistics as JSON to clients of a Unix socket (SIGUSR1 dumps to stderr)\n");
+		printf("  -o\tout-of-order timing model, \"default\" or e.g. width=4,rob=128,iq=32,lsq=48,ports=2,\n");
+		printf("    \tdepth=3,mul=4,div=20,load=3,penalty=10\n");
+		printf("  -d\tDRAM timing model, \"default\" or e.g. channels=1,ranks=1,banks=8,row=8192,\n");
+		printf("    \ttcas=11,trcd=11,trp=11,tburst=4,queue=32,ratio=4,sched=frfcfs|fcfs,cap=200\n");
+		printf("  -u\tkeep an undo log of <MiB> (e.g. %d) for rstep/rcontinue\n", UNDO_DEFAULT_MB);
+		printf("  -m\ttranslate addresses through a TLB, \"default\" or e.g. tlb=64,walk=sw|hw,ptbase=0x90000000\n");
+		printf("  -k\tload <kernel> at 0x%08x to handle exceptions; it starts at 0x%08x\n",
+			MEM_KTEXT_BEGIN, MMU_BOOT_VECTOR);
+		printf("  -e\tenergy accounting in pJ per event, \"default\" or e.g. fetch=8,alu=0.5,mul=3.1,div=15,\n");
+		printf("    \tload=8,store=8,rfread=0.6,rfwrite=0.8,act=1000,pre=500,rd=800,wr=850,clock=1000,cpi=1,leak=0\n");
+		printf("  -f\tdata prefetcher model, \"default\" or e.g. model=nextline|stride|stream|dcpt,degree=2,buffer=16,\n");
+		printf("    \tlatency=100,cache=32,ways=8,line=64,streams=4\n");
+		printf("  -l\ttime \"sim\" in parallel slices with -o/-d, \"default\" or e.g. slice=%d,warm=%d,jobs=<cores>\n",
+			SLICE_DEFAULT_LENGTH, SLICE_DEFAULT_WARMUP);
+		printf("  -c\tkeep loaded program images in <dir> so later starts of the same file skip loading\n");
+		printf("  -w\tstop hung runs, \"default\" or e.g. loop=1,instrs=100000000,secs=60 (0 turns a check off)\n");
+		printf("  -S\tserve jobs on a Unix socket instead of reading commands; no <input program> is needed\n");
+		printf("  -j\tnumber of server workers running jobs concurrently (default %d)\n\n", SERVER_DEFAULT_WORKERS);
+		exit(1);
+	}
+	if (SLICE_FLAG && (UNDO_FLAG || (!OOO_FLAG && !DRAM_FLAG))) {
+		printf("Error: sliced timing (-l) needs a timing model (-o or -d) and can't be combined with -u\n");
+		exit(1);
+	}
+	if (SLICE_FLAG && (ENERGY_FLAG || PREFETCH_FLAG)) {
+		printf("Error: sliced timing (-l) only times -o and -d, it can't be combined with -e or -f\n");
+		exit(1);
+	}
+	if (MMU_FLAG && kernel_path == NULL) {
+		printf("Error: the TLB (-m) starts empty and only a kernel fills it, load one with -k (e.g. benchmarks/kernel.in)\n");
+		exit(1);
+	}
+	if (UNDO_FLAG && (MMU_FLAG || kernel_path != NULL)) {
+		printf("Error: reverse execution (-u) does not record TLB or CP0 state, it can't be combined with -m or -k\n");
+		exit(1);
+	}
+	if (server_path != NULL && (trace_path != NULL || server_workers < 1 || server_workers > SERVER_MAX_WORKERS)) {
+		printf("Error: the server needs 1..%d workers (-j) and can't write a trace file (-t)\n",
+			SERVER_MAX_WORKERS);
 		exit(1);
 	}
 
-	strcpy(prog_file, argv[1]);
+	stats_start(stats_socket);
+	if (trace_path != NULL) {
+		if (!trace_open(trace_path)) {
+			exit(1);
+		}
+		TRACE_FLAG = FALSE;	/* the file replaces the terminal trace */
+	}
+
 	initialize();
+	if (server_path != NULL) {
+		/* jobs return their dumps, not a trace of every instruction */
+		TRACE_FLAG = FALSE;
+		if (kernel_path != NULL && !mmu_load_kernel(kernel_path)) {
+			exit(1);
+		}
+		server_run(server_path, server_workers);
+	}
 	load_program();
+	if (kernel_path != NULL) {
+		if (!mmu_load_kernel(kernel_path)) {
+			exit(1);
+		}
+		CURRENT_STATE.PC = MMU_BOOT_VECTOR;
+	}
 	help();
 	while (1){
 		handle_command();
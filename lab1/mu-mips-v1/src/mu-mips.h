@@ -1,3 +1,6 @@
+#ifndef MU_MIPS_H
+#define MU_MIPS_H
+
 #include <stdint.h>
 
 #define FALSE 0
@@ -28,12 +31,7 @@ typedef struct {
 } mem_region_t;
 
 /* memory will be dynamically allocated at initialization */
-mem_region_t MEM_REGIONS[] = {
-	{ MEM_TEXT_BEGIN, MEM_TEXT_END, NULL },
-	{ MEM_DATA_BEGIN, MEM_DATA_END, NULL },
-	{ MEM_KDATA_BEGIN, MEM_KDATA_END, NULL },
-	{ MEM_KTEXT_BEGIN, MEM_KTEXT_END, NULL }
-};
+extern mem_region_t MEM_REGIONS[];
 
 #define NUM_MEM_REGION 4
 #define MIPS_REGS 32
@@ -51,12 +49,13 @@ typedef struct CPU_State_Struct {
 /* CPU State info.                                                                                                               */
 /***************************************************************/
 
-CPU_State CURRENT_STATE, NEXT_STATE;
-int RUN_FLAG;	/* run flag*/
-uint32_t INSTRUCTION_COUNT;
-uint32_t PROGRAM_SIZE; /*in words*/
+extern CPU_State CURRENT_STATE, NEXT_STATE;
+extern int RUN_FLAG;	/* run flag*/
+extern uint32_t INSTRUCTION_COUNT;
+extern uint32_t PROGRAM_SIZE; /*in words*/
 
-char prog_file[32];
+extern char prog_file[256];
+extern int TRACE_FLAG;	/* print each instruction as it executes */
 
 
 /***************************************************************/
@@ -65,6 +64,7 @@ char prog_file[32];
 void help();
 uint32_t mem_read_32(uint32_t address);
 void mem_write_32(uint32_t address, uint32_t value);
+uint8_t *mem_host_ptr(uint32_t address, uint32_t *avail);
 void cycle();
 void run(int num_cycles);
 void runAll();
@@ -79,3 +79,4 @@ void initialize();
 void print_program(); /*IMPLEMENT THIS*/
 void print_instruction(uint32_t);
 
+#endif
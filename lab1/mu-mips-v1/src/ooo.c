@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "decode.h"
+#include "isa.h"
+#include "ooo.h"
+
+#define STORE_BUF_ENTRIES 1024	/* recent stores by word address, for forwarding */
+
+int OOO_FLAG = FALSE;
+
+static ooo_config_t CFG = {
+	.fetch_width = 4, .issue_width = 4, .commit_width = 4,
+	.rob_size = 128, .iq_size = 32, .lsq_size = 48,
+	.mem_ports = 2, .front_depth = 3,
+	.mul_latency = 4, .div_latency = 20, .load_latency = 3,
+	.redirect_penalty = 10
+};
+
+/* the model keeps one timestamp per resource instead of simulating every
+   cycle: each retired instruction is placed at the earliest cycle its
+   operands, the structures ahead of it and the issue slots allow */
+static uint64_t reg_ready[NUM_DEP_REGS];
+static uint64_t rob_commit[OOO_MAX_ROB];	/* ring by program order */
+static uint64_t lsq_commit[OOO_MAX_ROB];	/* ring by memory-op order */
+static uint64_t iq_issue[OOO_MAX_ROB];		/* cycle each IQ slot is freed */
+static struct {
+	uint64_t cycle;
+	uint8_t issued, mem;
+} slots[OOO_SLOT_RING];
+static struct {
+	uint32_t word;
+	uint64_t ready, commit;
+} store_buf[STORE_BUF_ENTRIES];
+
+static uint64_t seq, mem_seq;
+static uint64_t fetch_cycle, last_commit, div_free;
+static int fetch_count, commit_count;
+
+static uint8_t bpred[OOO_BPRED_ENTRIES];
+static uint32_t jr_target[OOO_BPRED_ENTRIES];
+static uint32_t ras[OOO_RAS_DEPTH];
+static int ras_top;
+
+static struct {
+	uint64_t rob_full, iq_full, lsq_full;
+	uint64_t redirect, drain;
+	uint64_t commit_wait[NUM_INST_CLASSES];
+	uint64_t rob_occupancy, iq_occupancy;
+	uint64_t predicted, mispredicts, forwards;
+} OOO;
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int ooo_configure(const char *spec) {
+	static const struct {
+		const char *name;
+		int *field;
+	} keys[] = {
+		{ "fetch", &CFG.fetch_width }, { "issue", &CFG.issue_width }, { "commit", &CFG.commit_width },
+		{ "rob", &CFG.rob_size }, { "iq", &CFG.iq_size }, { "lsq", &CFG.lsq_size },
+		{ "ports", &CFG.mem_ports }, { "depth", &CFG.front_depth },
+		{ "mul", &CFG.mul_latency }, { "div", &CFG.div_latency }, { "load", &CFG.load_latency },
+		{ "penalty", &CFG.redirect_penalty }
+	};
+	char copy[256], name[32], *tok;
+	int value, i, longest;
+
+	OOO_FLAG = TRUE;
+	if (strcmp(spec, "default") == 0) {
+		return TRUE;
+	}
+	strncpy(copy, spec, sizeof(copy) - 1);
+	copy[sizeof(copy) - 1] = '\0';
+	for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (sscanf(tok, "%31[^=]=%d", name, &value) != 2 || value < 0) {
+			printf("Error: bad timing option %s\n", tok);
+			return FALSE;
+		}
+		if (strcmp(name, "width") == 0) {
+			CFG.fetch_width = CFG.issue_width = CFG.commit_width = value;
+			continue;
+		}
+		for (i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+			if (strcmp(name, keys[i].name) == 0) {
+				*keys[i].field = value;
+				break;
+			}
+		}
+		if (i == (int)(sizeof(keys) / sizeof(keys[0]))) {
+			printf("Error: unknown timing option %s\n", name);
+			return FALSE;
+		}
+	}
+
+	longest = CFG.div_latency > CFG.load_latency ? CFG.div_latency : CFG.load_latency;
+	longest = CFG.mul_latency > longest ? CFG.mul_latency : longest;
+	if (CFG.fetch_width < 1 || CFG.fetch_width > OOO_MAX_WIDTH
+		|| CFG.issue_width < 1 || CFG.issue_width > OOO_MAX_WIDTH
+		|| CFG.commit_width < 1 || CFG.commit_width > OOO_MAX_WIDTH
+		|| CFG.rob_size < 1 || CFG.rob_size > OOO_MAX_ROB
+		|| CFG.iq_size < 1 || CFG.iq_size > CFG.rob_size
+		|| CFG.lsq_size < 1 || CFG.lsq_size > CFG.rob_size
+		|| CFG.mem_ports < 1 || CFG.mem_ports > CFG.issue_width
+		|| CFG.mul_latency < 1 || CFG.div_latency < 1 || CFG.load_latency < 1
+		|| (uint64_t)CFG.rob_size * (longest + 1) >= OOO_SLOT_RING / 2) {
+		printf("Error: timing configuration out of range (widths 1..%d, rob 1..%d, iq/lsq <= rob, ports <= issue)\n",
+			OOO_MAX_WIDTH, OOO_MAX_ROB);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Empty the pipeline and clear the counters (on reset)        */
+/***************************************************************/
+void ooo_reset() {
+	memset(reg_ready, 0, sizeof(reg_ready));
+	memset(rob_commit, 0, sizeof(rob_commit));
+	memset(lsq_commit, 0, sizeof(lsq_commit));
+	memset(iq_issue, 0, sizeof(iq_issue));
+	memset(slots, 0, sizeof(slots));
+	memset(store_buf, 0, sizeof(store_buf));
+	memset(bpred, 0, sizeof(bpred));
+	memset(jr_target, 0, sizeof(jr_target));
+	memset(&OOO, 0, sizeof(OOO));
+	seq = mem_seq = 0;
+	fetch_cycle = last_commit = div_free = 0;
+	fetch_count = commit_count = 0;
+	ras_top = 0;
+}
+
+/***************************************************************/
+/* Earliest cycle >= ready with a free issue slot (and memory  */
+/* port); claims the slot                                      */
+/***************************************************************/
+static uint64_t issue_at(uint64_t ready, int mem) {
+	uint64_t c;
+	int i;
+
+	for (c = ready; ; c++) {
+		i = c % OOO_SLOT_RING;
+		if (slots[i].cycle != c) {
+			slots[i].cycle = c;
+			slots[i].issued = slots[i].mem = 0;
+		}
+		if (slots[i].issued < CFG.issue_width && (!mem || slots[i].mem < CFG.mem_ports)) {
+			slots[i].issued++;
+			slots[i].mem += mem;
+			return c;
+		}
+	}
+}
+
+/***************************************************************/
+/* Predict a control transfer; TRUE if the front end guessed   */
+/* wrong and has to be redirected                              */
+/***************************************************************/
+static int mispredicted(const retire_t *r) {
+	int op = isa_decode(r->instruction);
+	uint32_t index = (r->pc >> 2) % OOO_BPRED_ENTRIES;
+	uint32_t predicted;
+	int taken;
+
+	if (r->iclass == CLASS_BRANCH_TAKEN || r->iclass == CLASS_BRANCH_NOT_TAKEN) {
+		taken = r->iclass == CLASS_BRANCH_TAKEN;
+		predicted = bpred[index] >= 2;
+		if (taken && bpred[index] < 3) {
+			bpred[index]++;
+		} else if (!taken && bpred[index] > 0) {
+			bpred[index]--;
+		}
+		OOO.predicted++;
+		return (int)predicted != taken;
+	}
+	if (op == ISA_JAL || op == ISA_JALR) {
+		/* JAL/JALR: remember the link for the matching JR $ra */
+		ras[ras_top] = op == ISA_JAL ? CURRENT_STATE.REGS[31] : CURRENT_STATE.REGS[(r->instruction >> 11) & 0x1F];
+		ras_top = (ras_top + 1) % OOO_RAS_DEPTH;
+	}
+	if (op == ISA_JR || op == ISA_JALR) {
+		if (op == ISA_JR && ((r->instruction >> 21) & 0x1F) == 31) {
+			ras_top = (ras_top + OOO_RAS_DEPTH - 1) % OOO_RAS_DEPTH;
+			predicted = ras[ras_top];
+		} else {
+			predicted = jr_target[index];
+		}
+		jr_target[index] = CURRENT_STATE.PC;
+		OOO.predicted++;
+		return predicted != CURRENT_STATE.PC;
+	}
+	return FALSE;	/* J/JAL targets are known at decode */
+}
+
+/***************************************************************/
+/* Place one retired instruction in the pipeline; called by    */
+/* cycle() after the functional state is committed             */
+/***************************************************************/
+void ooo_retire(const retire_t *r) {
+	int mem = r->iclass == CLASS_LOAD || r->iclass == CLASS_STORE;
+	int op = isa_decode(r->instruction);
+	int is_div = op == ISA_DIV || op == ISA_DIVU;
+	uint64_t fetch, dispatch, ready, issue, complete, commit, t;
+	inst_deps_t deps;
+	int i, slot;
+
+	decode_deps(r->instruction, &deps);
+
+	/* fetch: fetch_width per cycle, a taken transfer ends the group */
+	if (fetch_count >= CFG.fetch_width) {
+		fetch_cycle++;
+		fetch_count = 0;
+	}
+	fetch = fetch_cycle;
+	fetch_count++;
+
+	/* dispatch: needs a ROB entry, an IQ slot and, for memory ops, an LSQ entry */
+	dispatch = fetch + CFG.front_depth;
+	if (seq >= (uint64_t)CFG.rob_size) {
+		t = rob_commit[seq % CFG.rob_size] + 1;
+		if (t > dispatch) {
+			OOO.rob_full += t - dispatch;
+			dispatch = t;
+		}
+	}
+	slot = 0;
+	for (i = 1; i < CFG.iq_size; i++) {
+		if (iq_issue[i] < iq_issue[slot]) {
+			slot = i;
+		}
+	}
+	if (seq >= (uint64_t)CFG.iq_size && iq_issue[slot] + 1 > dispatch) {
+		OOO.iq_full += iq_issue[slot] + 1 - dispatch;
+		dispatch = iq_issue[slot] + 1;
+	}
+	if (mem && mem_seq >= (uint64_t)CFG.lsq_size) {
+		t = lsq_commit[mem_seq % CFG.lsq_size] + 1;
+		if (t > dispatch) {
+			OOO.lsq_full += t - dispatch;
+			dispatch = t;
+		}
+	}
+	/* a back-end stall backs up the front end too */
+	if (dispatch - CFG.front_depth > fetch_cycle) {
+		fetch_cycle = dispatch - CFG.front_depth;
+		fetch_count = 1;
+	}
+
+	/* issue: renamed sources ready, then a free slot and unit */
+	ready = dispatch + 1;
+	for (i = 0; i < 2; i++) {
+		if (deps.src[i] != REG_NONE && reg_ready[deps.src[i]] > ready) {
+			ready = reg_ready[deps.src[i]];
+		}
+	}
+	if (r->iclass == CLASS_SYSCALL && last_commit > ready) {
+		ready = last_commit;	/* serializing: waits for everything older */
+	}
+	if (is_div && div_free > ready) {
+		ready = div_free;	/* the divider is not pipelined */
+	}
+	issue = issue_at(ready, mem);
+	iq_issue[slot] = issue;
+
+	/* execute */
+	if (r->iclass == CLASS_LOAD) {
+		i = (r->mem_addr >> 2) % STORE_BUF_ENTRIES;
+		if (store_buf[i].word == r->mem_addr >> 2 && store_buf[i].commit > issue) {
+			/* older store still in the LSQ: forward its data */
+			complete = (store_buf[i].ready > issue ? store_buf[i].ready : issue) + 1;
+			OOO.forwards++;
+		} else {
+			complete = issue + CFG.load_latency;
+		}
+	} else if (is_div) {
+		complete = issue + CFG.div_latency;
+		div_free = complete;
+	} else if (r->iclass == CLASS_MULDIV) {
+		complete = issue + CFG.mul_latency;
+	} else {
+		complete = issue + 1;
+	}
+	for (i = 0; i < 2; i++) {
+		if (deps.dst[i] != REG_NONE) {
+			reg_ready[deps.dst[i]] = complete;
+		}
+	}
+
+	/* commit: in order, commit_width per cycle */
+	commit = complete + 1 > last_commit ? complete + 1 : last_commit;
+	if (commit == last_commit && commit_count >= CFG.commit_width) {
+		commit++;
+	}
+	if (seq > 0 && commit > last_commit + 1) {
+		OOO.commit_wait[r->iclass] += commit - last_commit - 1;	/* head not done yet */
+	}
+	commit_count = commit == last_commit ? commit_count + 1 : 1;
+	last_commit = commit;
+
+	rob_commit[seq % CFG.rob_size] = commit;
+	if (mem) {
+		lsq_commit[mem_seq % CFG.lsq_size] = commit;
+		mem_seq++;
+	}
+	if (r->iclass == CLASS_STORE) {
+		i = (r->mem_addr >> 2) % STORE_BUF_ENTRIES;
+		store_buf[i].word = r->mem_addr >> 2;
+		store_buf[i].ready = complete;
+		store_buf[i].commit = commit;
+	}
+	OOO.rob_occupancy += commit - dispatch;
+	OOO.iq_occupancy += issue - dispatch;
+	seq++;
+
+	/* front end after a control transfer or a syscall */
+	if (mispredicted(r)) {
+		OOO.mispredicts++;
+		t = complete + CFG.redirect_penalty;
+		if (t > fetch_cycle) {
+			OOO.redirect += t - fetch_cycle;
+			fetch_cycle = t;
+		}
+		fetch_count = 0;
+	} else if (r->iclass == CLASS_SYSCALL) {
+		if (commit > fetch_cycle) {
+			OOO.drain += commit - fetch_cycle;
+			fetch_cycle = commit;
+		}
+		fetch_count = 0;
+	} else if (r->iclass == CLASS_BRANCH_TAKEN || r->iclass == CLASS_JUMP) {
+		fetch_count = CFG.fetch_width;
+	}
+}
+
+/***************************************************************/
+/* Cycles from the first fetch to the last commit              */
+/***************************************************************/
+uint64_t ooo_cycles() {
+	return seq ? last_commit + 1 : 0;
+}
+
+/***************************************************************/
+/* Print IPC, occupancy and where the cycles went              */
+/***************************************************************/
+void ooo_report() {
+	uint64_t cycles = ooo_cycles();
+	int i;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Out-of-order timing: fetch/issue/commit %d/%d/%d, ROB %d, IQ %d, LSQ %d\n",
+		CFG.fetch_width, CFG.issue_width, CFG.commit_width, CFG.rob_size, CFG.iq_size, CFG.lsq_size);
+	printf("-------------------------------------------------------------\n");
+	printf("Instructions\t\t: %llu\n", (unsigned long long)seq);
+	printf("Cycles\t\t\t: %llu\n", (unsigned long long)cycles);
+	if (cycles == 0) {
+		printf("\n");
+		return;
+	}
+	printf("IPC\t\t\t: %.3f\n", (double)seq / cycles);
+	printf("Avg ROB occupancy\t: %.1f of %d\n", (double)OOO.rob_occupancy / cycles, CFG.rob_size);
+	printf("Avg IQ occupancy\t: %.1f of %d\n", (double)OOO.iq_occupancy / cycles, CFG.iq_size);
+	printf("Mispredicts\t\t: %llu of %llu (%.2f%%)\n", (unsigned long long)OOO.mispredicts,
+		(unsigned long long)OOO.predicted, OOO.predicted ? 100.0 * OOO.mispredicts / OOO.predicted : 0.0);
+	printf("Store-to-load forwards\t: %llu\n", (unsigned long long)OOO.forwards);
+	printf("-------------------------------------------------------------\n");
+	printf("[Stall]\t\t\t\t[Cycles]\n");
+	printf("dispatch: ROB full\t\t%llu\n", (unsigned long long)OOO.rob_full);
+	printf("dispatch: IQ full\t\t%llu\n", (unsigned long long)OOO.iq_full);
+	printf("dispatch: LSQ full\t\t%llu\n", (unsigned long long)OOO.lsq_full);
+	printf("fetch: mispredict redirect\t%llu\n", (unsigned long long)OOO.redirect);
+	printf("fetch: syscall drain\t\t%llu\n", (unsigned long long)OOO.drain);
+	for (i = 0; i < NUM_INST_CLASSES; i++) {
+		if (OOO.commit_wait[i]) {
+			printf("commit: head is %-16s%llu\n", CLASS_NAMES[i], (unsigned long long)OOO.commit_wait[i]);
+		}
+	}
+	printf("\n");
+}
@@ -0,0 +1,36 @@
+#ifndef OOO_H
+#define OOO_H
+
+#include <stdint.h>
+#include "stats.h"
+
+/******************************************************************************/
+/* Out-of-order superscalar timing model fed by the functional simulator      */
+/******************************************************************************/
+#define OOO_MAX_ROB   512
+#define OOO_MAX_WIDTH 16
+#define OOO_BPRED_ENTRIES 4096	/* 2-bit bimodal counters */
+#define OOO_RAS_DEPTH 16
+#define OOO_SLOT_RING 16384	/* per-cycle issue counters, > ROB x longest latency */
+
+typedef struct {
+	int fetch_width, issue_width, commit_width;
+	int rob_size, iq_size, lsq_size;
+	int mem_ports;			/* loads/stores issued per cycle */
+	int front_depth;		/* fetch to dispatch, in cycles */
+	int mul_latency, div_latency, load_latency;
+	int redirect_penalty;	/* extra cycles to refetch after a mispredict */
+} ooo_config_t;
+
+extern int OOO_FLAG;	/* -o: feed every retired instruction to the model */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int ooo_configure(const char *spec);
+void ooo_reset();
+void ooo_retire(const retire_t *r);
+void ooo_report();
+uint64_t ooo_cycles();
+
+#endif
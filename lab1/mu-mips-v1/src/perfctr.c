@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "mu-mips.h"
+#include "perfctr.h"
+#include "stats.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+int PERF_FLAG = FALSE;
+
+static const char *PERF_NAMES[PERF_NUM_EVENTS] = {
+	"cycles", "instructions", "branch-misses", "L1D-read-misses", "LLC-misses", "iTLB-misses"
+};
+
+static int perf_fds[PERF_NUM_EVENTS];
+static int perf_opened = FALSE;
+static int perf_errno;
+static uint32_t start_instructions;
+static uint64_t start_branches;
+
+#ifdef __linux__
+#define CACHE_EVENT(cache, op, result) \
+	((cache) | ((op) << 8) | ((result) << 16))
+
+static int perf_open(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/***************************************************************/
+/* Open every counter once; unsupported ones stay at -1        */
+/***************************************************************/
+static void perf_open_all() {
+	int i;
+
+	perf_fds[PERF_CYCLES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	perf_fds[PERF_INSTRUCTIONS] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	perf_fds[PERF_BRANCH_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	perf_fds[PERF_L1D_MISSES] = perf_open(PERF_TYPE_HW_CACHE,
+		CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+	perf_fds[PERF_LLC_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	perf_fds[PERF_ITLB_MISSES] = perf_open(PERF_TYPE_HW_CACHE,
+		CACHE_EVENT(PERF_COUNT_HW_CACHE_ITLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+
+	perf_errno = 0;
+	for (i = 0; i < PERF_NUM_EVENTS; i++) {
+		if (perf_fds[i] < 0 && perf_errno == 0) {
+			perf_errno = errno;
+		}
+	}
+	perf_opened = TRUE;
+}
+
+/***************************************************************/
+/* Counter value scaled up if the kernel had to multiplex it   */
+/***************************************************************/
+static int perf_read(int fd, double *value) {
+	uint64_t data[3];	/* value, time enabled, time running */
+
+	if (fd < 0 || read(fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+		return FALSE;
+	}
+	*value = (double)data[0] * ((double)data[1] / (double)data[2]);
+	return TRUE;
+}
+#endif
+
+/***************************************************************/
+/* Reset and start the host counters                           */
+/***************************************************************/
+void perf_begin() {
+#ifdef __linux__
+	int i;
+
+	if (!perf_opened) {
+		perf_open_all();
+	}
+	for (i = 0; i < PERF_NUM_EVENTS; i++) {
+		if (perf_fds[i] >= 0) {
+			ioctl(perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+	start_instructions = INSTRUCTION_COUNT;
+	start_branches = stats_branches();
+}
+
+/***************************************************************/
+/* Stop the host counters and report them per guest instruction */
+/***************************************************************/
+void perf_end() {
+	uint32_t guest_instructions = INSTRUCTION_COUNT - start_instructions;
+	uint64_t guest_branches = stats_branches() - start_branches;
+#ifdef __linux__
+	double value[PERF_NUM_EVENTS];
+	int valid[PERF_NUM_EVENTS];
+	int i, any = FALSE;
+
+	for (i = 0; i < PERF_NUM_EVENTS; i++) {
+		if (perf_fds[i] >= 0) {
+			ioctl(perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+	for (i = 0; i < PERF_NUM_EVENTS; i++) {
+		valid[i] = perf_read(perf_fds[i], &value[i]);
+		any |= valid[i];
+	}
+
+	printf("-------------------------------------------------------------\n");
+	printf("Host counters for %u guest instructions (%llu branches)\n",
+		guest_instructions, (unsigned long long)guest_branches);
+	printf("-------------------------------------------------------------\n");
+	if (!any) {
+		printf("Host performance counters unavailable: %s\n\n", strerror(perf_errno));
+		return;
+	}
+	printf("[Event]\t\t\t[Total]\t\t[Per guest instruction]\n");
+	for (i = 0; i < PERF_NUM_EVENTS; i++) {
+		if (!valid[i]) {
+			printf("%-16s\tn/a\n", PERF_NAMES[i]);
+			continue;
+		}
+		printf("%-16s\t%-12.0f\t%.3f\n", PERF_NAMES[i], value[i],
+			guest_instructions ? value[i] / guest_instructions : 0.0);
+	}
+	if (valid[PERF_BRANCH_MISSES] && guest_branches) {
+		printf("branch-misses per guest branch\t\t%.3f\n", value[PERF_BRANCH_MISSES] / guest_branches);
+	}
+	if (valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] && value[PERF_CYCLES] > 0) {
+		printf("host IPC\t\t\t\t%.3f\n", value[PERF_INSTRUCTIONS] / value[PERF_CYCLES]);
+	}
+	printf("\n");
+#else
+	(void)PERF_NAMES;
+	(void)perf_fds;
+	(void)perf_opened;
+	(void)perf_errno;
+	printf("Host performance counters unavailable on this platform (%u guest instructions, %llu branches)\n\n",
+		guest_instructions, (unsigned long long)guest_branches);
+#endif
+}
@@ -0,0 +1,27 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Host hardware counters sampled around run()/runAll()                       */
+/******************************************************************************/
+enum {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_ITLB_MISSES,
+	PERF_NUM_EVENTS
+};
+
+extern int PERF_FLAG;	/* -p: report host counters after each run */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void perf_begin();
+void perf_end();
+
+#endif
@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "isa.h"
+#include "prefetch.h"
+
+int PREFETCH_FLAG = FALSE;
+
+static const char *MODEL_NAMES[PF_NUM_MODELS] = { "nextline", "stride", "stream", "dcpt" };
+
+static prefetch_config_t CFG = {
+	.model = PF_STRIDE,
+	.cache_kb = 32, .ways = 8, .line = 64,
+	.buffer = 16,
+	.degree = 2,
+	.latency = 100,
+	.streams = 4
+};
+
+/* data cache: line number + 1 per way, 0 when empty */
+static uint32_t *TAGS;
+static uint64_t *LRU;
+static int sets;
+
+static struct {
+	uint32_t line;
+	uint32_t trigger_pc;	/* the access that caused the prefetch */
+	uint64_t ready;			/* instruction count when the line arrives */
+	int valid;
+} FILL[PF_MAX_BUFFER];
+static int fill_next;		/* FIFO replacement */
+
+static struct {
+	uint32_t pc;
+	int used, is_load;
+	uint64_t accesses, misses;
+	uint64_t timely, late;		/* misses a prefetch covered */
+	uint64_t issued, useful;	/* prefetches this PC triggered */
+} PCS[PF_PC_SLOTS];
+
+static struct {
+	uint64_t loads, stores, misses;
+	uint64_t timely, late;
+	uint64_t issued, filtered, useful, evicted;
+} PF;
+
+/* model state */
+static struct {
+	uint32_t pc, last_addr;
+	int32_t stride;
+	int confidence;
+} STRIDES[PF_TABLE_SLOTS];
+
+static struct {
+	uint32_t last_line;
+	int dir, valid;
+	uint64_t used;
+} STREAMS[PF_MAX_STREAMS];
+static uint32_t last_miss_line;
+
+static struct {
+	uint32_t pc, last_line;
+	int32_t deltas[PF_DELTAS];	/* oldest first */
+	int n;
+} DCPT[PF_TABLE_SLOTS];
+
+static uint64_t now;	/* instructions retired */
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int prefetch_configure(const char *spec) {
+	static const struct {
+		const char *name;
+		int *field;
+	} keys[] = {
+		{ "cache", &CFG.cache_kb }, { "ways", &CFG.ways }, { "line", &CFG.line },
+		{ "buffer", &CFG.buffer }, { "degree", &CFG.degree }, { "latency", &CFG.latency },
+		{ "streams", &CFG.streams }
+	};
+	char copy[256], name[32], value[32], *tok;
+	int i;
+
+	PREFETCH_FLAG = TRUE;
+	if (strcmp(spec, "default") != 0) {
+		strncpy(copy, spec, sizeof(copy) - 1);
+		copy[sizeof(copy) - 1] = '\0';
+		for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+			if (sscanf(tok, "%31[^=]=%31s", name, value) != 2) {
+				printf("Error: bad prefetch option %s\n", tok);
+				return FALSE;
+			}
+			if (strcmp(name, "model") == 0) {
+				for (i = 0; i < PF_NUM_MODELS && strcmp(value, MODEL_NAMES[i]) != 0; i++) {
+				}
+				if (i == PF_NUM_MODELS) {
+					printf("Error: unknown prefetcher %s (use nextline, stride, stream or dcpt)\n", value);
+					return FALSE;
+				}
+				CFG.model = i;
+				continue;
+			}
+			for (i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); i++) {
+				if (strcmp(name, keys[i].name) == 0) {
+					*keys[i].field = atoi(value);
+					break;
+				}
+			}
+			if (i == (int)(sizeof(keys) / sizeof(keys[0]))) {
+				printf("Error: unknown prefetch option %s\n", name);
+				return FALSE;
+			}
+		}
+	}
+
+	if (CFG.line < 4 || (CFG.line & (CFG.line - 1)) != 0 || CFG.ways < 1 || CFG.cache_kb < 1
+		|| CFG.cache_kb * 1024 % (CFG.ways * CFG.line) != 0
+		|| CFG.buffer < 1 || CFG.buffer > PF_MAX_BUFFER || CFG.degree < 1 || CFG.latency < 0
+		|| CFG.streams < 1 || CFG.streams > PF_MAX_STREAMS) {
+		printf("Error: prefetch configuration out of range (power-of-two lines, cache a multiple of ways x line, "
+			"buffer 1..%d, streams 1..%d)\n", PF_MAX_BUFFER, PF_MAX_STREAMS);
+		return FALSE;
+	}
+	sets = CFG.cache_kb * 1024 / (CFG.ways * CFG.line);
+	free(TAGS);	/* -f given again */
+	free(LRU);
+	TAGS = calloc((size_t)sets * CFG.ways, sizeof(*TAGS));
+	LRU = calloc((size_t)sets * CFG.ways, sizeof(*LRU));
+	prefetch_reset();
+	return TRUE;
+}
+
+/***************************************************************/
+/* Empty the cache, the fill buffer and the models (on reset)  */
+/***************************************************************/
+void prefetch_reset() {
+	if (TAGS != NULL) {
+		memset(TAGS, 0, (size_t)sets * CFG.ways * sizeof(*TAGS));
+		memset(LRU, 0, (size_t)sets * CFG.ways * sizeof(*LRU));
+	}
+	memset(FILL, 0, sizeof(FILL));
+	fill_next = 0;
+	memset(PCS, 0, sizeof(PCS));
+	memset(&PF, 0, sizeof(PF));
+	memset(STRIDES, 0, sizeof(STRIDES));
+	memset(STREAMS, 0, sizeof(STREAMS));
+	memset(DCPT, 0, sizeof(DCPT));
+	last_miss_line = 0;
+	now = 0;
+}
+
+/***************************************************************/
+/* Data cache: look up <line>, optionally refreshing its age   */
+/***************************************************************/
+static int cache_has(uint32_t line, int touch) {
+	uint32_t *tags = TAGS + (size_t)(line % sets) * CFG.ways;
+	int w;
+
+	for (w = 0; w < CFG.ways; w++) {
+		if (tags[w] == line + 1) {
+			if (touch) {
+				LRU[(size_t)(line % sets) * CFG.ways + w] = now;
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void cache_fill(uint32_t line) {
+	size_t base = (size_t)(line % sets) * CFG.ways;
+	int w, victim = 0;
+
+	for (w = 0; w < CFG.ways; w++) {
+		if (TAGS[base + w] == 0) {
+			victim = w;
+			break;
+		}
+		if (LRU[base + w] < LRU[base + victim]) {
+			victim = w;
+		}
+	}
+	TAGS[base + victim] = line + 1;
+	LRU[base + victim] = now;
+}
+
+static int fill_find(uint32_t line) {
+	int i;
+
+	for (i = 0; i < CFG.buffer; i++) {
+		if (FILL[i].valid && FILL[i].line == line) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/***************************************************************/
+/* Per-PC counter slot; -1 once the table is full              */
+/***************************************************************/
+static int pc_slot(uint32_t pc) {
+	uint32_t slot = (pc >> 2) % PF_PC_SLOTS;
+	int probes;
+
+	for (probes = 0; probes < PF_PC_SLOTS; probes++) {
+		if (!PCS[slot].used) {
+			PCS[slot].used = TRUE;
+			PCS[slot].pc = pc;
+		}
+		if (PCS[slot].pc == pc) {
+			return slot;
+		}
+		slot = (slot + 1) % PF_PC_SLOTS;
+	}
+	return -1;
+}
+
+/***************************************************************/
+/* Send a prefetch for <line> into the fill buffer unless the  */
+/* line is already cached or on its way                        */
+/***************************************************************/
+static void issue(uint32_t line, uint32_t trigger_pc) {
+	int slot;
+
+	if (cache_has(line, FALSE) || fill_find(line) >= 0) {
+		PF.filtered++;
+		return;
+	}
+	if (FILL[fill_next].valid) {
+		PF.evicted++;	/* never used */
+	}
+	FILL[fill_next].line = line;
+	FILL[fill_next].trigger_pc = trigger_pc;
+	FILL[fill_next].ready = now + CFG.latency;
+	FILL[fill_next].valid = TRUE;
+	fill_next = (fill_next + 1) % CFG.buffer;
+	PF.issued++;
+	if ((slot = pc_slot(trigger_pc)) >= 0) {
+		PCS[slot].issued++;
+	}
+}
+
+/***************************************************************/
+/* The models: each sees every access and whether it missed    */
+/* the cache or was served from the fill buffer                */
+/***************************************************************/
+static void train_nextline(uint32_t pc, uint32_t addr, uint32_t line, int triggered) {
+	int k;
+
+	(void)addr;
+	/* tagged: a miss or the first use of a prefetched line */
+	if (triggered) {
+		for (k = 1; k <= CFG.degree; k++) {
+			issue(line + k, pc);
+		}
+	}
+}
+
+static void train_stride(uint32_t pc, uint32_t addr, uint32_t line, int triggered) {
+	int slot = (pc >> 2) % PF_TABLE_SLOTS, k;
+	int32_t delta;
+	uint32_t target, last = line;
+
+	(void)triggered;
+	if (STRIDES[slot].pc != pc) {
+		STRIDES[slot].pc = pc;
+		STRIDES[slot].last_addr = addr;
+		STRIDES[slot].stride = 0;
+		STRIDES[slot].confidence = 0;
+		return;
+	}
+	delta = (int32_t)(addr - STRIDES[slot].last_addr);
+	STRIDES[slot].last_addr = addr;
+	if (delta == STRIDES[slot].stride) {
+		if (STRIDES[slot].confidence < 3) {
+			STRIDES[slot].confidence++;
+		}
+	} else if (STRIDES[slot].confidence > 0) {
+		STRIDES[slot].confidence--;
+	} else {
+		STRIDES[slot].stride = delta;
+	}
+	if (STRIDES[slot].confidence < 2 || STRIDES[slot].stride == 0) {
+		return;
+	}
+	for (k = 1; k <= CFG.degree; k++) {
+		target = (addr + (uint32_t)(k * STRIDES[slot].stride)) / CFG.line;
+		if (target != last) {
+			issue(target, pc);
+			last = target;
+		}
+	}
+}
+
+static void train_stream(uint32_t pc, uint32_t addr, uint32_t line, int triggered) {
+	int s, k, found = -1, victim = 0;
+
+	(void)addr;
+	if (!triggered) {
+		return;
+	}
+	for (s = 0; s < CFG.streams && found < 0; s++) {
+		for (k = 1; STREAMS[s].valid && k <= CFG.degree; k++) {
+			if (STREAMS[s].last_line + (uint32_t)(k * STREAMS[s].dir) == line) {
+				found = s;
+				break;
+			}
+		}
+	}
+	if (found < 0) {
+		for (s = 0; s < CFG.streams; s++) {
+			if (!STREAMS[s].valid) {
+				victim = s;
+				break;
+			}
+			if (STREAMS[s].used < STREAMS[victim].used) {
+				victim = s;
+			}
+		}
+		found = victim;
+		STREAMS[found].valid = TRUE;
+		STREAMS[found].dir = last_miss_line == line + 1 ? -1 : 1;
+	}
+	last_miss_line = line;
+	STREAMS[found].last_line = line;
+	STREAMS[found].used = now;
+	for (k = 1; k <= CFG.degree; k++) {
+		issue(line + (uint32_t)(k * STREAMS[found].dir), pc);
+	}
+}
+
+static void train_dcpt(uint32_t pc, uint32_t addr, uint32_t line, int triggered) {
+	int slot = (pc >> 2) % PF_TABLE_SLOTS, i, j, n, issued;
+	int32_t d1, d2;
+	uint32_t target;
+
+	(void)addr;
+	(void)triggered;
+	if (DCPT[slot].pc != pc) {
+		memset(&DCPT[slot], 0, sizeof(DCPT[slot]));
+		DCPT[slot].pc = pc;
+		DCPT[slot].last_line = line;
+		return;
+	}
+	if (line == DCPT[slot].last_line) {
+		return;
+	}
+	if (DCPT[slot].n == PF_DELTAS) {
+		memmove(DCPT[slot].deltas, DCPT[slot].deltas + 1, (PF_DELTAS - 1) * sizeof(int32_t));
+		DCPT[slot].n--;
+	}
+	DCPT[slot].deltas[DCPT[slot].n++] = (int32_t)(line - DCPT[slot].last_line);
+	DCPT[slot].last_line = line;
+	n = DCPT[slot].n;
+	if (n < 3) {
+		return;
+	}
+	/* find the latest earlier occurrence of the newest delta pair and
+	   replay what followed it, wrapping for periodic patterns */
+	d1 = DCPT[slot].deltas[n - 2];
+	d2 = DCPT[slot].deltas[n - 1];
+	for (i = n - 2; i >= 1; i--) {
+		if (DCPT[slot].deltas[i - 1] == d1 && DCPT[slot].deltas[i] == d2) {
+			break;
+		}
+	}
+	if (i < 1) {
+		return;
+	}
+	target = line;
+	for (issued = 0, j = i + 1; issued < CFG.degree; issued++) {
+		target += DCPT[slot].deltas[j];
+		issue(target, pc);
+		j = j + 1 < n ? j + 1 : i + 1;
+	}
+}
+
+static void (*const TRAIN[PF_NUM_MODELS])(uint32_t pc, uint32_t addr, uint32_t line, int triggered) = {
+	train_nextline, train_stride, train_stream, train_dcpt
+};
+
+/***************************************************************/
+/* Feed the instruction just executed to the cache and model   */
+/***************************************************************/
+void prefetch_retire(const retire_t *r) {
+	uint32_t line;
+	int slot, fill, trigger, triggered = FALSE;
+
+	now++;
+	if (r->iclass != CLASS_LOAD && r->iclass != CLASS_STORE) {
+		return;
+	}
+	line = r->mem_addr / CFG.line;
+	slot = pc_slot(r->pc);
+	if (r->iclass == CLASS_LOAD) {
+		PF.loads++;
+	} else {
+		PF.stores++;
+	}
+	if (slot >= 0) {
+		PCS[slot].accesses++;
+		PCS[slot].is_load |= r->iclass == CLASS_LOAD;
+	}
+
+	if (!cache_has(line, TRUE)) {
+		/* prefetched lines only enter the cache when used, so the
+		   cache holds what it would hold without a prefetcher and
+		   this counts the misses of the plain cache */
+		PF.misses++;
+		triggered = TRUE;
+		if (slot >= 0) {
+			PCS[slot].misses++;
+		}
+		fill = fill_find(line);
+		if (fill >= 0) {
+			if (FILL[fill].ready <= now) {
+				PF.timely++;
+			} else {
+				PF.late++;
+			}
+			if (slot >= 0) {
+				if (FILL[fill].ready <= now) {
+					PCS[slot].timely++;
+				} else {
+					PCS[slot].late++;
+				}
+			}
+			PF.useful++;
+			if ((trigger = pc_slot(FILL[fill].trigger_pc)) >= 0) {
+				PCS[trigger].useful++;
+			}
+			FILL[fill].valid = FALSE;
+		}
+		cache_fill(line);
+	}
+	TRAIN[CFG.model](r->pc, r->mem_addr, line, triggered);
+}
+
+static int by_misses(const void *a, const void *b) {
+	uint64_t ma = PCS[*(const int *)a].misses, mb = PCS[*(const int *)b].misses;
+
+	return ma < mb ? 1 : ma > mb ? -1 : 0;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+	return whole ? 100.0 * part / whole : 0.0;
+}
+
+/***************************************************************/
+/* Print coverage, accuracy and timeliness, overall and for    */
+/* the loads that miss most                                    */
+/***************************************************************/
+void prefetch_report() {
+	char text[ISA_TEXT_MAX];
+	int i, n, *order;
+
+	printf("-------------------------------------------------------------\n");
+	printf("Prefetch: %s, degree %d, %d-entry fill buffer, %d instruction latency, %d KiB %d-way cache, %d byte lines\n",
+		MODEL_NAMES[CFG.model], CFG.degree, CFG.buffer, CFG.latency, CFG.cache_kb, CFG.ways, CFG.line);
+	printf("-------------------------------------------------------------\n");
+	printf("Accesses\t\t: %llu (%llu loads, %llu stores)\n", (unsigned long long)(PF.loads + PF.stores),
+		(unsigned long long)PF.loads, (unsigned long long)PF.stores);
+	if (PF.loads + PF.stores == 0) {
+		printf("\n");
+		return;
+	}
+	printf("Misses without prefetch\t: %llu (%.2f%% of accesses)\n", (unsigned long long)PF.misses,
+		percent(PF.misses, PF.loads + PF.stores));
+	printf("Prefetches issued\t: %llu (%llu more were already cached or in flight)\n",
+		(unsigned long long)PF.issued, (unsigned long long)PF.filtered);
+	printf("Accuracy\t\t: %.2f%% (%llu used, %llu evicted unused)\n", percent(PF.useful, PF.issued),
+		(unsigned long long)PF.useful, (unsigned long long)PF.evicted);
+	printf("Coverage\t\t: %.2f%% of misses\n", percent(PF.timely + PF.late, PF.misses));
+	printf("Timeliness\t\t: %.2f%% arrived in time (%llu late)\n", percent(PF.timely, PF.timely + PF.late),
+		(unsigned long long)PF.late);
+	printf("-------------------------------------------------------------\n");
+	printf("[Load PC]\t[Accesses]\t[Misses]\t[Coverage]\t[Timely]\t[Accuracy]\t[Instruction]\n");
+	order = malloc(PF_PC_SLOTS * sizeof(*order));
+	for (i = n = 0; i < PF_PC_SLOTS; i++) {
+		if (PCS[i].used && PCS[i].is_load && PCS[i].misses > 0) {
+			order[n++] = i;
+		}
+	}
+	qsort(order, n, sizeof(*order), by_misses);
+	for (i = 0; i < n && i < PF_TOP_PCS; i++) {
+		text[isa_disassemble(mem_read_32(PCS[order[i]].pc), text)] = '\0';
+		printf("0x%08x\t%-12llu\t%-12llu\t%6.2f%%\t\t%6.2f%%\t\t%6.2f%%\t\t%s\n", PCS[order[i]].pc,
+			(unsigned long long)PCS[order[i]].accesses, (unsigned long long)PCS[order[i]].misses,
+			percent(PCS[order[i]].timely + PCS[order[i]].late, PCS[order[i]].misses),
+			percent(PCS[order[i]].timely, PCS[order[i]].timely + PCS[order[i]].late),
+			percent(PCS[order[i]].useful, PCS[order[i]].issued), text);
+	}
+	free(order);
+	printf("\n");
+}
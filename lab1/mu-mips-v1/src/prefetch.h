@@ -0,0 +1,44 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include "stats.h"
+
+/******************************************************************************/
+/* Data prefetcher models: a set-associative data cache, a fill buffer that   */
+/* holds prefetched lines until a demand access uses them, and one of several */
+/* prefetchers trained on the guest load/store stream                         */
+/******************************************************************************/
+#define PF_NEXTLINE 0	/* the next <degree> lines after each access */
+#define PF_STRIDE   1	/* per-PC stride with a confidence counter */
+#define PF_STREAM   2	/* sequential stream buffers allocated on misses */
+#define PF_DCPT     3	/* per-PC delta history, replay after a repeated delta pair */
+#define PF_NUM_MODELS 4
+
+#define PF_MAX_BUFFER   256	/* fill buffer entries */
+#define PF_TABLE_SLOTS  256	/* stride and DCPT tables, indexed by PC */
+#define PF_MAX_STREAMS  16
+#define PF_DELTAS       16	/* DCPT deltas kept per PC */
+#define PF_PC_SLOTS     4096	/* per-PC report table, open addressing */
+#define PF_TOP_PCS      10
+
+typedef struct {
+	int model;			/* PF_* */
+	int cache_kb, ways, line;	/* data cache the prefetches fill */
+	int buffer;			/* fill buffer entries */
+	int degree;			/* lines prefetched per trigger */
+	int latency;		/* instructions until a prefetched line arrives */
+	int streams;		/* stream buffers (stream model) */
+} prefetch_config_t;
+
+extern int PREFETCH_FLAG;	/* -f: feed loads and stores to a prefetcher */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int prefetch_configure(const char *spec);
+void prefetch_reset();
+void prefetch_retire(const retire_t *r);
+void prefetch_report();
+
+#endif
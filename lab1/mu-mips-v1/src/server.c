@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "mu-mips.h"
+#include "server.h"
+
+typedef struct {
+	char program[256];
+	int inline_image;		/* program is a temporary file holding an image line's words */
+	uint32_t regs[MIPS_REGS], hi, lo, pc;
+	uint32_t set_regs;		/* bit n: reg n was given */
+	int set_hi, set_lo, set_pc;
+	int budget;				/* -1: run to the end */
+	int rdump;
+	int num_dumps;
+	uint32_t dumps[SERVER_MAX_DUMPS][2];
+} job_t;
+
+static int listen_fd = -1;
+static pid_t WORKERS[SERVER_MAX_WORKERS];
+static volatile sig_atomic_t stopping = 0;
+
+static int socket_listen(const char *path) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SERVER_MAX_WORKERS) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/***************************************************************/
+/* Copy the <words> lines after an image line into a temporary */
+/* program file, so reset() can load and reload it like any    */
+/* other; fails on a short or malformed payload                */
+/***************************************************************/
+static int read_image(FILE *in, unsigned long words, job_t *job) {
+	char line[64], *end;
+	unsigned long i;
+	FILE *out;
+	int fd;
+
+	if (words == 0 || words > (MEM_TEXT_END - MEM_TEXT_BEGIN + 1) / 4) {
+		printf("job error: image size %lu is out of range\n", words);
+		return FALSE;
+	}
+	strcpy(job->program, SERVER_IMAGE_TEMPLATE);
+	fd = mkstemp(job->program);
+	out = fd < 0 ? NULL : fdopen(fd, "w");
+	if (out == NULL) {
+		printf("job error: can't create a file for the image\n");
+		if (fd >= 0) {
+			close(fd);
+			unlink(job->program);
+		}
+		job->program[0] = '\0';
+		return FALSE;
+	}
+	job->inline_image = TRUE;
+	for (i = 0; i < words; i++) {
+		if (fgets(line, sizeof(line), in) == NULL) {
+			break;
+		}
+		strtoul(line, &end, 16);
+		if (end == line || (*end != '\n' && *end != '\r' && *end != '\0')) {
+			break;
+		}
+		fputs(line, out);
+		if (*end != '\n') {
+			fputc('\n', out);
+		}
+	}
+	fclose(out);
+	if (i < words) {
+		printf("job error: image word %lu of %lu is missing or not hex\n", i + 1, words);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Read one job request; on a bad line prints why and fails   */
+/***************************************************************/
+static int parse_job(FILE *in, job_t *job) {
+	char line[512], key[32], a[256], b[64];
+	unsigned long budget;
+	int n, reg;
+
+	memset(job, 0, sizeof(*job));
+	job->budget = -1;
+	while (fgets(line, sizeof(line), in) != NULL) {
+		n = sscanf(line, "%31s %255s %63s", key, a, b);
+		if (n <= 0) {
+			break;
+		}
+		if ((strcmp(key, "program") == 0 || strcmp(key, "image") == 0) && job->program[0] != '\0') {
+			printf("job error: more than one program or image given\n");
+			return FALSE;
+		} else if (strcmp(key, "program") == 0 && n >= 2) {
+			strcpy(job->program, a);	/* %255s fits */
+		} else if (strcmp(key, "image") == 0 && n >= 2) {
+			if (!read_image(in, strtoul(a, NULL, 0), job)) {
+				return FALSE;
+			}
+		} else if (strcmp(key, "reg") == 0 && n == 3 && (reg = atoi(a)) >= 0 && reg < MIPS_REGS) {
+			job->regs[reg] = strtoul(b, NULL, 0);
+			job->set_regs |= 1u << reg;
+		} else if (strcmp(key, "hi") == 0 && n >= 2) {
+			job->hi = strtoul(a, NULL, 0);
+			job->set_hi = TRUE;
+		} else if (strcmp(key, "lo") == 0 && n >= 2) {
+			job->lo = strtoul(a, NULL, 0);
+			job->set_lo = TRUE;
+		} else if (strcmp(key, "pc") == 0 && n >= 2) {
+			job->pc = strtoul(a, NULL, 0);
+			job->set_pc = TRUE;
+		} else if (strcmp(key, "budget") == 0 && n >= 2) {
+			budget = strtoul(a, NULL, 0);
+			job->budget = budget > INT_MAX ? INT_MAX : (int)budget;
+		} else if (strcmp(key, "rdump") == 0) {
+			job->rdump = TRUE;
+		} else if (strcmp(key, "mdump") == 0 && n == 3 && job->num_dumps < SERVER_MAX_DUMPS) {
+			job->dumps[job->num_dumps][0] = strtoul(a, NULL, 0);
+			job->dumps[job->num_dumps][1] = strtoul(b, NULL, 0);
+			job->num_dumps++;
+		} else {
+			line[strcspn(line, "\n")] = '\0';
+			printf("job error: bad request line \"%s\"\n", line);
+			return FALSE;
+		}
+	}
+	if (job->program[0] == '\0') {
+		printf("job error: no program or image given\n");
+		return FALSE;
+	}
+	if (access(job->program, R_OK) != 0) {
+		printf("job error: can't open program file %s\n", job->program);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/***************************************************************/
+/* Recycle this simulator for the job and run it               */
+/***************************************************************/
+static void run_job(job_t *job) {
+	int i;
+
+	strcpy(prog_file, job->program);
+	reset();
+	for (i = 0; i < MIPS_REGS; i++) {
+		if (job->set_regs & (1u << i)) {
+			CURRENT_STATE.REGS[i] = job->regs[i];
+		}
+	}
+	if (job->set_hi) {
+		CURRENT_STATE.HI = job->hi;
+	}
+	if (job->set_lo) {
+		CURRENT_STATE.LO = job->lo;
+	}
+	if (job->set_pc) {
+		CURRENT_STATE.PC = job->pc;
+	}
+	NEXT_STATE = CURRENT_STATE;
+
+	if (job->budget >= 0) {
+		run(job->budget);
+	} else {
+		runAll();
+	}
+	if (job->rdump) {
+		rdump();
+	}
+	for (i = 0; i < job->num_dumps; i++) {
+		mdump(job->dumps[i][0], job->dumps[i][1]);
+	}
+	printf("job done: %u instructions, pc 0x%08x, %s\n", INSTRUCTION_COUNT, CURRENT_STATE.PC,
+		RUN_FLAG ? "budget exhausted" : "stopped");
+}
+
+/***************************************************************/
+/* Serve one connection: everything printed goes to the client */
+/***************************************************************/
+static void serve(int fd) {
+	job_t job;
+	FILE *in;
+	int saved, in_fd;
+
+	in_fd = dup(fd);
+	in = in_fd < 0 ? NULL : fdopen(in_fd, "r");
+	if (in == NULL) {
+		if (in_fd >= 0) {
+			close(in_fd);
+		}
+		close(fd);
+		return;
+	}
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	dup2(fd, STDOUT_FILENO);
+
+	if (parse_job(in, &job)) {
+		run_job(&job);
+	}
+	if (job.inline_image) {
+		unlink(job.program);
+	}
+
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+	fclose(in);
+	close(fd);
+}
+
+static void worker() {
+	int fd, null_fd;
+
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	/* a guest read of stdin must not block on the server's terminal */
+	null_fd = open("/dev/null", O_RDONLY);
+	if (null_fd >= 0) {
+		dup2(null_fd, STDIN_FILENO);
+		close(null_fd);
+	}
+	for (;;) {
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd >= 0) {
+			serve(fd);
+		}
+	}
+}
+
+static pid_t spawn() {
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0) {
+		worker();
+		_exit(0);
+	}
+	return pid;
+}
+
+static void on_stop(int sig) {
+	(void)sig;
+	stopping = 1;
+}
+
+/***************************************************************/
+/* Fork the workers from this initialized simulator, keep the  */
+/* pool full until SIGINT or SIGTERM, then take it down        */
+/***************************************************************/
+void server_run(const char *socket_path, int workers) {
+	struct sigaction sa;
+	pid_t pid;
+	int i, status;
+
+	listen_fd = socket_listen(socket_path);
+	if (listen_fd < 0) {
+		printf("Error: can't listen for jobs on %s\n", socket_path);
+		exit(1);
+	}
+	/* a client hanging up mid-reply must not kill its worker */
+	signal(SIGPIPE, SIG_IGN);
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_stop;
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+
+	for (i = 0; i < workers; i++) {
+		WORKERS[i] = spawn();
+	}
+	printf("Serving jobs on %s with %d workers.\n\n", socket_path, workers);
+	fflush(stdout);
+
+	while (!stopping) {
+		pid = wait(&status);
+		if (pid < 0) {
+			if (errno != EINTR) {
+				break;
+			}
+			continue;
+		}
+		for (i = 0; i < workers && !stopping; i++) {
+			if (WORKERS[i] == pid) {
+				printf("Warning: worker %d exited, starting another\n", (int)pid);
+				fflush(stdout);
+				WORKERS[i] = spawn();
+			}
+		}
+	}
+
+	for (i = 0; i < workers; i++) {
+		if (WORKERS[i] > 0) {
+			kill(WORKERS[i], SIGTERM);
+		}
+	}
+	while (wait(&status) > 0 || errno == EINTR) {
+	}
+	close(listen_fd);
+	unlink(socket_path);
+	exit(0);
+}
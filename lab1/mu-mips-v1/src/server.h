@@ -0,0 +1,30 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/******************************************************************************/
+/* Simulation server: a pool of preforked, already initialized simulators    */
+/* taking jobs over a Unix socket, one job per connection                    */
+/*                                                                            */
+/* A job is a list of lines ending with a blank line or the end of input:     */
+/*   program <path>        program to load                                    */
+/*   image <n>             or: the program itself, as the next n lines of     */
+/*                         hex words in the .in file format                   */
+/*   reg <n> <value>       initial value of register n                        */
+/*   hi|lo|pc <value>      initial HI, LO or PC                               */
+/*   budget <n>            run at most n instructions (default: to the end)   */
+/*   rdump                 return the registers after the run                 */
+/*   mdump <start> <stop>  return the memory range after the run              */
+/* The reply is everything the simulator printed for the job, followed by     */
+/* one "job done" or "job error" line.                                        */
+/******************************************************************************/
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_MAX_WORKERS     64
+#define SERVER_MAX_DUMPS       16
+#define SERVER_IMAGE_TEMPLATE  "/tmp/mu-mips-job-XXXXXX"
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void server_run(const char *socket_path, int workers);
+
+#endif
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "mu-mips.h"
+#include "stats.h"
+#include "syscall.h"
+#include "ooo.h"
+#include "dram.h"
+#include "prefetch.h"
+#include "energy.h"
+#include "hang.h"
+#include "trace.h"
+#include "mmapseg.h"
+#include "slice.h"
+
+#define SLICE_MAX_LISTED 32	/* slices listed one by one in the report */
+
+int SLICE_FLAG = FALSE;
+
+static slice_config_t CFG = { .slice = SLICE_DEFAULT_LENGTH, .warmup = SLICE_DEFAULT_WARMUP, .jobs = 0 };
+
+static slice_result_t *RESULTS;
+static int num_results;
+static uint64_t run_length;			/* instructions the functional pass ran */
+static double functional_secs, total_secs;
+
+/***************************************************************/
+/* Parse "default" or key=value[,key=value...] into the config */
+/***************************************************************/
+int slice_configure(const char *spec) {
+	char copy[256], name[32], *tok;
+	unsigned long long value;
+
+	SLICE_FLAG = TRUE;
+	CFG.jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (strcmp(spec, "default") != 0) {
+		strncpy(copy, spec, sizeof(copy) - 1);
+		copy[sizeof(copy) - 1] = '\0';
+		for (tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+			if (sscanf(tok, "%31[^=]=%llu", name, &value) != 2) {
+				printf("Error: bad slice option %s\n", tok);
+				return FALSE;
+			}
+			if (strcmp(name, "slice") == 0) {
+				CFG.slice = value;
+			} else if (strcmp(name, "warm") == 0) {
+				CFG.warmup = value;
+			} else if (strcmp(name, "jobs") == 0) {
+				CFG.jobs = (int)value;
+			} else {
+				printf("Error: unknown slice option %s\n", name);
+				return FALSE;
+			}
+		}
+	}
+	if (CFG.slice < 1 || CFG.warmup >= CFG.slice || CFG.jobs < 1) {
+		printf("Error: slice configuration out of range (warm must be shorter than slice, jobs at least 1)\n");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static double seconds_since(const struct timespec *t) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+}
+
+static uint64_t model_cycles() {
+	return OOO_FLAG ? ooo_cycles() : dram_cycles();
+}
+
+/***************************************************************/
+/* Worker: from the forked checkpoint, warm the models up, then */
+/* time one slice and leave the result in slot <k>             */
+/***************************************************************/
+static void time_slice(int k, int fd, uint64_t warmup, int ooo_on, int dram_on) {
+	slice_result_t res;
+	dram_events_t e0, e1;
+	sim_stats_t s0;
+	uint64_t c0, i;
+	int null_fd;
+
+	/* the functional pass already showed the program's output */
+	null_fd = open("/dev/null", O_WRONLY);
+	if (null_fd >= 0) {
+		dup2(null_fd, STDOUT_FILENO);
+		close(null_fd);
+	}
+	/* stores replayed into a shared window would reach the file and the parent */
+	if (!mmap_detach()) {
+		_exit(1);
+	}
+	TRACE_FLAG = FALSE;
+	TRACE_ASYNC = FALSE;	/* the writer thread stayed behind in the parent */
+	HANG_FLAG = FALSE;
+	SYSCALL_REPLAY = TRUE;
+	OOO_FLAG = ooo_on;
+	DRAM_FLAG = dram_on;
+	if (OOO_FLAG) {
+		ooo_reset();
+	}
+	if (DRAM_FLAG) {
+		dram_reset();
+	}
+
+	memset(&res, 0, sizeof(res));
+	res.start = (uint64_t)k * CFG.slice;
+	for (i = 0; i < warmup && RUN_FLAG; i++) {
+		cycle();
+	}
+	c0 = model_cycles();
+	s0 = STATS;
+	memset(&e0, 0, sizeof(e0));
+	if (DRAM_FLAG) {
+		dram_events(&e0);
+	}
+	for (i = 0; i < CFG.slice && RUN_FLAG; i++) {
+		cycle();
+	}
+	res.instructions = i;
+	res.cycles = model_cycles() - c0;
+	for (i = 0; i < NUM_INST_CLASSES; i++) {
+		res.by_class[i] = STATS.by_class[i] - s0.by_class[i];
+	}
+	if (DRAM_FLAG) {
+		dram_events(&e1);
+		res.activates = e1.activates - e0.activates;
+		res.precharges = e1.precharges - e0.precharges;
+		res.reads = e1.reads - e0.reads;
+		res.writes = e1.writes - e0.writes;
+	}
+	res.stopped = REPLAY_STOPPED;
+	res.done = TRUE;
+	if (pwrite(fd, &res, sizeof(res), (off_t)k * sizeof(res)) != (ssize_t)sizeof(res)) {
+		_exit(1);
+	}
+	_exit(0);
+}
+
+/* where slice k's worker forks off: its warm-up before the slice */
+static uint64_t fork_point(int k) {
+	uint64_t begin = (uint64_t)k * CFG.slice;
+
+	return begin > CFG.warmup ? begin - CFG.warmup : 0;
+}
+
+/***************************************************************/
+/* Run the program functionally to the end, forking a worker   */
+/* at each checkpoint, then gather what the workers measured   */
+/***************************************************************/
+void slice_run() {
+	int ooo_on = OOO_FLAG, dram_on = DRAM_FLAG, prefetch_on = PREFETCH_FLAG, energy_on = ENERGY_FLAG;
+	struct timespec start;
+	FILE *results;
+	uint64_t done = 0;
+	int k = 0, live = 0, fd;
+	pid_t pid;
+
+	results = tmpfile();
+	if (results == NULL) {
+		printf("Error: can't create the slice result file\n");
+		RUN_FLAG = FALSE;
+		return;
+	}
+	fd = fileno(results);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* the checkpoints only need the architectural state */
+	OOO_FLAG = DRAM_FLAG = PREFETCH_FLAG = ENERGY_FLAG = FALSE;
+	while (RUN_FLAG) {
+		while (fork_point(k) == done) {
+			if (live == CFG.jobs && wait(NULL) > 0) {
+				live--;
+			}
+			fflush(stdout);
+			pid = fork();
+			if (pid == 0) {
+				time_slice(k, fd, (uint64_t)k * CFG.slice - done, ooo_on, dram_on);
+			}
+			if (pid > 0) {
+				live++;
+			} else {
+				printf("Warning: can't fork the worker for slice %d, it is not timed\n", k);
+			}
+			k++;
+		}
+		cycle();
+		done++;
+	}
+	functional_secs = seconds_since(&start);
+	OOO_FLAG = ooo_on;
+	DRAM_FLAG = dram_on;
+	PREFETCH_FLAG = prefetch_on;
+	ENERGY_FLAG = energy_on;
+
+	while (live > 0 && wait(NULL) > 0) {
+		live--;
+	}
+	total_secs = seconds_since(&start);
+
+	free(RESULTS);
+	RESULTS = calloc(k, sizeof(*RESULTS));
+	num_results = 0;
+	run_length = done;
+	for (; k > 0; k--) {
+		if (pread(fd, &RESULTS[num_results], sizeof(*RESULTS), (off_t)num_results * sizeof(*RESULTS))
+			!= (ssize_t)sizeof(*RESULTS)) {
+			memset(&RESULTS[num_results], 0, sizeof(*RESULTS));
+		}
+		num_results++;
+	}
+	fclose(results);
+}
+
+/***************************************************************/
+/* Forget the last sliced run (on reset)                       */
+/***************************************************************/
+void slice_reset() {
+	free(RESULTS);
+	RESULTS = NULL;
+	num_results = 0;
+	run_length = 0;
+}
+
+/* true once a sliced "sim" has run since the last reset */
+int slice_has_results() {
+	return RESULTS != NULL;
+}
+
+/***************************************************************/
+/* Merge the slices into totals for the whole run              */
+/***************************************************************/
+void slice_report() {
+	uint64_t instructions = 0, cycles = 0, reads = 0, writes = 0, activates = 0;
+	int i, timed = 0, stopped = 0, lost = 0;
+
+	for (i = 0; i < num_results; i++) {
+		if (!RESULTS[i].done) {
+			lost++;
+			continue;
+		}
+		stopped += RESULTS[i].stopped;
+		if (RESULTS[i].instructions == 0) {
+			continue;	/* the program ended or stopped during the warm-up */
+		}
+		timed++;
+		instructions += RESULTS[i].instructions;
+		cycles += RESULTS[i].cycles;
+		reads += RESULTS[i].reads;
+		writes += RESULTS[i].writes;
+		activates += RESULTS[i].activates;
+	}
+
+	printf("-------------------------------------------------------------\n");
+	printf("Sliced timing: %llu instruction slices, %llu warm-up, %d workers, %s cycles\n",
+		(unsigned long long)CFG.slice, (unsigned long long)CFG.warmup, CFG.jobs,
+		OOO_FLAG ? "out-of-order" : "DRAM");
+	printf("-------------------------------------------------------------\n");
+	printf("Slices\t\t\t: %d timed", timed);
+	if (stopped > 0) {
+		printf(", %d stopped early at file or input syscalls", stopped);
+	}
+	if (lost > 0) {
+		printf(", %d lost (worker failed)", lost);
+	}
+	printf("\n");
+	printf("Instructions timed\t: %llu of %llu (%.2f%%)\n", (unsigned long long)instructions,
+		(unsigned long long)run_length, run_length ? 100.0 * instructions / run_length : 0.0);
+	if (instructions == 0) {
+		printf("\n");
+		return;
+	}
+	printf("Cycles\t\t\t: %llu (IPC %.3f)\n", (unsigned long long)cycles, cycles ? (double)instructions / cycles : 0.0);
+	if (DRAM_FLAG) {
+		printf("DRAM requests\t\t: %llu reads, %llu writes, %llu activates\n", (unsigned long long)reads,
+			(unsigned long long)writes, (unsigned long long)activates);
+	}
+	printf("Wall clock\t\t: %.3f s functional pass, %.3f s in total\n", functional_secs, total_secs);
+	printf("-------------------------------------------------------------\n");
+	printf("[Slice]\t[Start]\t\t[Instructions]\t[Cycles]\t[IPC]\n");
+	for (i = 0; i < num_results && i < SLICE_MAX_LISTED; i++) {
+		if (RESULTS[i].done && (RESULTS[i].instructions > 0 || RESULTS[i].stopped)) {
+			printf("%d\t%-12llu\t%-12llu\t%-12llu\t%.3f%s\n", i, (unsigned long long)RESULTS[i].start,
+				(unsigned long long)RESULTS[i].instructions, (unsigned long long)RESULTS[i].cycles,
+				RESULTS[i].cycles ? (double)RESULTS[i].instructions / RESULTS[i].cycles : 0.0,
+				RESULTS[i].stopped ? " (stopped at a syscall)" : "");
+		}
+	}
+	if (num_results > SLICE_MAX_LISTED) {
+		printf("(%d more slices)\n", num_results - SLICE_MAX_LISTED);
+	}
+	printf("\n");
+}
@@ -0,0 +1,41 @@
+#ifndef SLICE_H
+#define SLICE_H
+
+#include <stdint.h>
+#include "stats.h"
+
+/******************************************************************************/
+/* Sliced timing: one fast functional pass forks a checkpoint every <slice>   */
+/* instructions, and worker processes time the slices in parallel with the   */
+/* detailed models, each after a short warm-up                                */
+/******************************************************************************/
+#define SLICE_DEFAULT_LENGTH 1000000
+#define SLICE_DEFAULT_WARMUP 100000
+
+typedef struct {
+	uint64_t slice;		/* instructions timed per slice */
+	uint64_t warmup;	/* instructions run before the slice to warm the models */
+	int jobs;			/* slices timed at once */
+} slice_config_t;
+
+typedef struct {
+	int done;			/* the worker finished */
+	int stopped;		/* cut short by a syscall that can't be repeated */
+	uint64_t start;		/* instruction count where the slice begins */
+	uint64_t instructions, cycles;
+	uint64_t by_class[NUM_INST_CLASSES];
+	uint64_t activates, precharges, reads, writes;
+} slice_result_t;
+
+extern int SLICE_FLAG;	/* -l: time "sim" in parallel slices */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int slice_configure(const char *spec);
+void slice_run();
+void slice_report();
+void slice_reset();
+int slice_has_results();
+
+#endif
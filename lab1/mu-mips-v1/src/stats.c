@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mu-mips.h"
+#include "stats.h"
+
+sim_stats_t STATS;
+retire_t RETIRED;
+
+const char *CLASS_NAMES[NUM_INST_CLASSES] = {
+	"alu", "load", "store", "branch_taken", "branch_not_taken", "jump", "muldiv", "syscall"
+};
+
+static int listen_fd = -1;
+
+/***************************************************************/
+/* Clear the counters (on reset)                               */
+/***************************************************************/
+void stats_reset() {
+	memset(&STATS, 0, sizeof(STATS));
+}
+
+uint64_t stats_branches() {
+	return STATS.by_class[CLASS_BRANCH_TAKEN] + STATS.by_class[CLASS_BRANCH_NOT_TAKEN];
+}
+
+/***************************************************************/
+/* Format a snapshot of the counters as one line of JSON       */
+/***************************************************************/
+int stats_json(char *buf, int size) {
+	/* volatile reads: the simulation thread keeps writing meanwhile */
+	volatile sim_stats_t *live = &STATS;
+	int i, len;
+
+	len = snprintf(buf, size, "{\"instructions\":%u,\"pc\":\"0x%08x\",\"running\":%s,\"classes\":{",
+		*(volatile uint32_t *)&INSTRUCTION_COUNT, *(volatile uint32_t *)&CURRENT_STATE.PC,
+		*(volatile int *)&RUN_FLAG ? "true" : "false");
+	for (i = 0; i < NUM_INST_CLASSES && len < size; i++) {
+		len += snprintf(buf + len, size - len, "%s\"%s\":%llu", i ? "," : "",
+			CLASS_NAMES[i], (unsigned long long)live->by_class[i]);
+	}
+	if (len < size) {
+		len += snprintf(buf + len, size - len, "},\"bytes_read\":%llu,\"bytes_written\":%llu}\n",
+			(unsigned long long)live->bytes_read, (unsigned long long)live->bytes_written);
+	}
+	return len < size ? len : size - 1;
+}
+
+static void write_all(int fd, const char *buf, int len) {
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n <= 0) {
+			return;
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/***************************************************************/
+/* SIGUSR1 dumps a snapshot to stderr from this thread, so the */
+/* simulation thread never runs a handler                      */
+/***************************************************************/
+static void *signal_thread(void *arg) {
+	sigset_t *set = arg;
+	char buf[1024];
+	int sig;
+
+	for (;;) {
+		if (sigwait(set, &sig) == 0) {
+			write_all(STDERR_FILENO, buf, stats_json(buf, sizeof(buf)));
+		}
+	}
+	return NULL;
+}
+
+/***************************************************************/
+/* Stream a snapshot to one socket client until it hangs up    */
+/***************************************************************/
+static void *client_thread(void *arg) {
+	int fd = (int)(intptr_t)arg;
+	char buf[1024];
+	int len;
+
+	for (;;) {
+		len = stats_json(buf, sizeof(buf));
+		if (send(fd, buf, len, MSG_NOSIGNAL) != len) {
+			break;
+		}
+		usleep(STATS_INTERVAL_MS * 1000);
+	}
+	close(fd);
+	return NULL;
+}
+
+static void *socket_thread(void *arg) {
+	pthread_t tid;
+	int fd;
+
+	(void)arg;
+	for (;;) {
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			continue;
+		}
+		if (pthread_create(&tid, NULL, client_thread, (void *)(intptr_t)fd) != 0) {
+			close(fd);
+			continue;
+		}
+		pthread_detach(tid);
+	}
+	return NULL;
+}
+
+static int socket_listen(const char *path) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/***************************************************************/
+/* Start the reader threads; call before any other thread runs */
+/***************************************************************/
+void stats_start(const char *socket_path) {
+	static sigset_t set;
+	pthread_t tid;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	if (pthread_create(&tid, NULL, signal_thread, &set) == 0) {
+		pthread_detach(tid);
+	}
+
+	if (socket_path == NULL) {
+		return;
+	}
+	listen_fd = socket_listen(socket_path);
+	if (listen_fd < 0) {
+		printf("Warning: can't listen for statistics on %s\n", socket_path);
+		return;
+	}
+	if (pthread_create(&tid, NULL, socket_thread, NULL) == 0) {
+		pthread_detach(tid);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Live execution statistics, readable while a simulation is running          */
+/******************************************************************************/
+enum {
+	CLASS_ALU,
+	CLASS_LOAD,
+	CLASS_STORE,
+	CLASS_BRANCH_TAKEN,
+	CLASS_BRANCH_NOT_TAKEN,
+	CLASS_JUMP,
+	CLASS_MULDIV,
+	CLASS_SYSCALL,
+	NUM_INST_CLASSES
+};
+
+typedef struct {
+	uint64_t by_class[NUM_INST_CLASSES];
+	uint64_t bytes_read, bytes_written;
+} sim_stats_t;
+
+/* updated by handle_instruction() without locking; readers tolerate races */
+extern sim_stats_t STATS;
+extern const char *CLASS_NAMES[NUM_INST_CLASSES];
+
+/* the instruction handle_instruction() just executed, for timing models */
+typedef struct {
+	uint32_t pc, instruction;
+	uint32_t mem_addr;	/* effective address of loads and stores */
+	int iclass;
+} retire_t;
+
+extern retire_t RETIRED;
+
+#define STATS_INTERVAL_MS 1000	/* socket clients get a snapshot this often */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void stats_reset();
+void stats_start(const char *socket_path);
+int stats_json(char *buf, int size);
+uint64_t stats_branches();
+
+#endif
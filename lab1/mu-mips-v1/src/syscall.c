@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mu-mips.h"
+#include "syscall.h"
+#include "mmapseg.h"
+#include "undo.h"
+#include "mmu.h"
+
+#define REG_V0 2
+#define REG_A0 4
+#define REG_A1 5
+#define REG_A2 6
+
+typedef struct {
+	int host_fd;	/* -1 when the slot is free */
+	uint8_t *buf;	/* guest writes waiting to be flushed */
+	uint32_t len, size;
+} guest_file_t;
+
+static guest_file_t GUEST_FILES[GUEST_MAX_FILES];
+static int files_ready = FALSE;
+static int prompt_line_pending = FALSE; /* rest of the "sim"/"run" line is still on stdin */
+
+uint32_t HEAP_BREAK = HEAP_BEGIN;
+int EXIT_STATUS;
+int SYSCALL_REPLAY = FALSE;
+int REPLAY_STOPPED = FALSE;
+
+/***************************************************************/
+/* Write out everything buffered for one guest file            */
+/***************************************************************/
+static void file_flush(guest_file_t *f) {
+	uint32_t done = 0;
+	ssize_t n;
+
+	if (f->len == 0) {
+		return;
+	}
+	/* keep simulator messages ahead of guest output on the terminal */
+	if (f->host_fd == STDOUT_FILENO || f->host_fd == STDERR_FILENO) {
+		fflush(stdout);
+	}
+	while (done < f->len) {
+		n = write(f->host_fd, f->buf + done, f->len - done);
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+	f->len = 0;
+}
+
+/***************************************************************/
+/* Append bytes to a guest file's write buffer                 */
+/***************************************************************/
+static void file_put(guest_file_t *f, const uint8_t *data, uint32_t count) {
+	if (f->buf == NULL) {
+		f->size = (f->host_fd == STDOUT_FILENO) ? GUEST_STDOUT_BUF : GUEST_FILE_BUF;
+		f->buf = malloc(f->size);
+	}
+	if (f->len + count > f->size) {
+		file_flush(f);
+	}
+	if (count >= f->size) {
+		/* too big to be worth buffering */
+		f->len = 0;
+		while (count > 0) {
+			ssize_t n = write(f->host_fd, data, count);
+			if (n <= 0) {
+				break;
+			}
+			data += n;
+			count -= n;
+		}
+		return;
+	}
+	memcpy(f->buf + f->len, data, count);
+	f->len += count;
+}
+
+static void file_close(guest_file_t *f) {
+	file_flush(f);
+	if (f->host_fd > STDERR_FILENO) {
+		close(f->host_fd);
+	}
+	free(f->buf);
+	f->buf = NULL;
+	f->len = f->size = 0;
+	f->host_fd = -1;
+}
+
+static guest_file_t *guest_file(uint32_t fd) {
+	if (fd >= GUEST_MAX_FILES || GUEST_FILES[fd].host_fd < 0) {
+		return NULL;
+	}
+	return &GUEST_FILES[fd];
+}
+
+/***************************************************************/
+/* Contiguous host bytes behind [addr, addr+count), 0 if none  */
+/***************************************************************/
+static uint32_t guest_span(uint32_t addr, uint32_t count, int write, uint8_t **ptr) {
+	uint32_t avail;
+
+	*ptr = MMU_FLAG ? mmu_guest_ptr(addr, write, &avail) : mem_host_ptr(addr, &avail);
+	if (*ptr == NULL) {
+		return 0;
+	}
+	return count < avail ? count : avail;
+}
+
+/***************************************************************/
+/* Copy a NUL-terminated guest string (truncated to size-1)    */
+/***************************************************************/
+static void guest_string(uint32_t addr, char *dst, uint32_t size) {
+	uint32_t i = 0, span;
+	uint8_t *src, *end;
+
+	while (i + 1 < size) {
+		span = guest_span(addr + i, size - 1 - i, FALSE, &src);
+		if (span == 0) {
+			break;
+		}
+		end = memchr(src, 0, span);
+		if (end != NULL) {
+			memcpy(dst + i, src, end - src);
+			i += end - src;
+			break;
+		}
+		memcpy(dst + i, src, span);
+		i += span;
+	}
+	dst[i] = '\0';
+}
+
+/***************************************************************/
+/* Copy host bytes into guest memory, returns bytes copied     */
+/***************************************************************/
+static uint32_t guest_store(uint32_t addr, const char *src, uint32_t count) {
+	uint32_t done = 0, span;
+	uint8_t *dst;
+
+	while (done < count) {
+		span = guest_span(addr + done, count - done, TRUE, &dst);
+		if (span == 0 || (MMAP_RO_WINDOWS && mmap_read_only(addr + done, span))) {
+			break;
+		}
+		if (UNDO_OPEN) {
+			undo_save_range(addr + done, span);	/* only what is really overwritten */
+		}
+		memcpy(dst, src + done, span);
+		done += span;
+	}
+	return done;
+}
+
+/***************************************************************/
+/* Get stdin ready for a guest read                            */
+/***************************************************************/
+static void stdin_prepare() {
+	int c;
+
+	file_flush(&GUEST_FILES[STDOUT_FILENO]);
+	fflush(stdout);
+	if (prompt_line_pending) {
+		/* the command that started the run leaves its newline behind */
+		c = getchar();
+		if (c != '\n' && c != EOF) {
+			ungetc(c, stdin);
+		}
+		prompt_line_pending = FALSE;
+	}
+}
+
+/***************************************************************/
+/* Read one line from the host stdin                           */
+/***************************************************************/
+static int read_line(char *line, int size) {
+	stdin_prepare();
+	return fgets(line, size, stdin) != NULL;
+}
+
+static uint32_t sys_print_string(uint32_t addr) {
+	guest_file_t *out = &GUEST_FILES[STDOUT_FILENO];
+	uint32_t span;
+	uint8_t *src, *end;
+
+	for (;;) {
+		span = guest_span(addr, GUEST_STDOUT_BUF, FALSE, &src);
+		if (span == 0) {
+			break;
+		}
+		end = memchr(src, 0, span);
+		file_put(out, src, end != NULL ? (uint32_t)(end - src) : span);
+		if (end != NULL) {
+			break;
+		}
+		addr += span;
+	}
+	return 0;
+}
+
+static uint32_t sys_read_string(uint32_t addr, uint32_t size) {
+	char line[GUEST_LINE_MAX];
+	uint32_t len;
+
+	if (size == 0) {
+		return 0;
+	}
+	/* $a1 is the guest's word; longer lines are cut at the buffer */
+	if (size > GUEST_LINE_MAX) {
+		size = GUEST_LINE_MAX;
+	}
+	if (size == 1 || !read_line(line, (int)size)) {
+		line[0] = '\0';
+	}
+	len = strlen(line);
+	guest_store(addr, line, len + 1);
+	return 0;
+}
+
+static uint32_t sys_sbrk(int32_t amount) {
+	uint32_t old_break = HEAP_BREAK;
+	int64_t new_break = (int64_t)HEAP_BREAK + amount;
+
+	if (new_break < HEAP_BEGIN || new_break > (int64_t)MEM_STACK_BEGIN + 1 - STACK_RESERVE) {
+		return (uint32_t)-1;
+	}
+	/* keep the break word aligned */
+	HEAP_BREAK = ((uint32_t)new_break + 3) & ~3u;
+	return old_break;
+}
+
+static uint32_t sys_open(uint32_t path_addr, uint32_t flags, uint32_t mode) {
+	char path[256];
+	int host_flags, fd, i;
+
+	switch (flags) {
+		case 0: host_flags = O_RDONLY; break;
+		case 1: host_flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+		case 9: host_flags = O_WRONLY | O_CREAT | O_APPEND; break;
+		default: return (uint32_t)-1;
+	}
+	for (i = STDERR_FILENO + 1; i < GUEST_MAX_FILES; i++) {
+		if (GUEST_FILES[i].host_fd < 0) {
+			break;
+		}
+	}
+	if (i == GUEST_MAX_FILES) {
+		return (uint32_t)-1;
+	}
+	guest_string(path_addr, path, sizeof(path));
+	fd = open(path, host_flags, mode ? mode : 0644);
+	if (fd < 0) {
+		return (uint32_t)-1;
+	}
+	GUEST_FILES[i].host_fd = fd;
+	return i;
+}
+
+static uint32_t sys_read(uint32_t fd, uint32_t addr, uint32_t count) {
+	guest_file_t *f = guest_file(fd);
+	uint32_t done = 0, span;
+	uint8_t *dst;
+	ssize_t n;
+	int c;
+
+	if (f == NULL) {
+		return (uint32_t)-1;
+	}
+	if (f->host_fd == STDIN_FILENO) {
+		/* stdin is shared with the command prompt, so go through stdio */
+		stdin_prepare();
+		while (done < count && (c = getchar()) != EOF) {
+			char ch = c;
+			guest_store(addr + done, &ch, 1);
+			done++;
+			if (ch == '\n') {
+				break;
+			}
+		}
+		return done;
+	}
+	file_flush(f);
+	while (done < count) {
+		span = guest_span(addr + done, count - done, TRUE, &dst);
+		if (span == 0 || (MMAP_RO_WINDOWS && mmap_read_only(addr + done, span))) {
+			break;
+		}
+		if (UNDO_OPEN) {
+			undo_save_range(addr + done, span);
+		}
+		n = read(f->host_fd, dst, span);
+		if (n < 0) {
+			return done ? done : (uint32_t)-1;
+		}
+		done += n;
+		if ((uint32_t)n < span) {
+			break;
+		}
+	}
+	return done;
+}
+
+static uint32_t sys_write(uint32_t fd, uint32_t addr, uint32_t count) {
+	guest_file_t *f = guest_file(fd);
+	uint32_t done = 0, span;
+	uint8_t *src;
+
+	if (f == NULL || f->host_fd == STDIN_FILENO) {
+		return (uint32_t)-1;
+	}
+	while (done < count) {
+		span = guest_span(addr + done, count - done, FALSE, &src);
+		if (span == 0) {
+			break;
+		}
+		file_put(f, src, span);
+		done += span;
+	}
+	return done;
+}
+
+static uint32_t sys_close(uint32_t fd) {
+	guest_file_t *f = guest_file(fd);
+
+	if (f == NULL) {
+		return (uint32_t)-1;
+	}
+	if (fd <= STDERR_FILENO) {
+		file_flush(f);
+		return 0;
+	}
+	file_close(f);
+	return 0;
+}
+
+/***************************************************************/
+/* Close guest files and rewind the heap                       */
+/***************************************************************/
+void syscall_reset() {
+	int i;
+
+	for (i = 0; i < GUEST_MAX_FILES; i++) {
+		if (files_ready && GUEST_FILES[i].host_fd >= 0) {
+			file_close(&GUEST_FILES[i]);
+		}
+		GUEST_FILES[i].host_fd = (i <= STDERR_FILENO) ? i : -1;
+	}
+	files_ready = TRUE;
+	prompt_line_pending = TRUE;
+	HEAP_BREAK = HEAP_BEGIN;
+	EXIT_STATUS = 0;
+}
+
+/***************************************************************/
+/* Push buffered guest output to the host                      */
+/***************************************************************/
+void syscall_flush() {
+	int i;
+
+	prompt_line_pending = TRUE;
+	if (!files_ready) {
+		return;
+	}
+	for (i = 0; i < GUEST_MAX_FILES; i++) {
+		if (GUEST_FILES[i].host_fd >= 0) {
+			file_flush(&GUEST_FILES[i]);
+		}
+	}
+}
+
+/***************************************************************/
+/* Dispatch SYSCALL on the service number in $v0               */
+/***************************************************************/
+void handle_syscall() {
+	uint32_t v0 = CURRENT_STATE.REGS[REG_V0];
+	uint32_t a0 = CURRENT_STATE.REGS[REG_A0];
+	uint32_t a1 = CURRENT_STATE.REGS[REG_A1];
+	uint32_t a2 = CURRENT_STATE.REGS[REG_A2];
+	char line[64];
+	int len;
+	uint8_t ch;
+
+	if (!files_ready) {
+		syscall_reset();
+	}
+	/* the first run already read its input and wrote its files; doing it
+	   again would consume or clobber them, and the results aren't known */
+	if (SYSCALL_REPLAY && v0 != SYS_PRINT_INT && v0 != SYS_PRINT_STRING && v0 != SYS_PRINT_CHAR
+		&& v0 != SYS_SBRK && v0 != SYS_EXIT && v0 != SYS_EXIT2) {
+		REPLAY_STOPPED = TRUE;
+		RUN_FLAG = FALSE;
+		return;
+	}
+
+	switch (v0) {
+		case SYS_PRINT_INT:
+			len = sprintf(line, "%d", (int32_t)a0);
+			file_put(&GUEST_FILES[STDOUT_FILENO], (uint8_t *)line, len);
+			break;
+		case SYS_PRINT_STRING:
+			sys_print_string(a0);
+			break;
+		case SYS_READ_INT:
+			CURRENT_STATE.REGS[REG_V0] = read_line(line, sizeof(line)) ? (uint32_t)strtol(line, NULL, 0) : 0;
+			break;
+		case SYS_READ_STRING:
+			sys_read_string(a0, a1);
+			break;
+		case SYS_SBRK:
+			CURRENT_STATE.REGS[REG_V0] = sys_sbrk((int32_t)a0);
+			break;
+		case SYS_EXIT:
+			RUN_FLAG = FALSE;
+			break;
+		case SYS_PRINT_CHAR:
+			ch = a0 & 0xFF;
+			file_put(&GUEST_FILES[STDOUT_FILENO], &ch, 1);
+			break;
+		case SYS_READ_CHAR:
+			stdin_prepare();
+			CURRENT_STATE.REGS[REG_V0] = getchar() & 0xFF;
+			break;
+		case SYS_OPEN:
+			CURRENT_STATE.REGS[REG_V0] = sys_open(a0, a1, a2);
+			break;
+		case SYS_READ:
+			CURRENT_STATE.REGS[REG_V0] = sys_read(a0, a1, a2);
+			break;
+		case SYS_WRITE:
+			CURRENT_STATE.REGS[REG_V0] = sys_write(a0, a1, a2);
+			break;
+		case SYS_CLOSE:
+			CURRENT_STATE.REGS[REG_V0] = sys_close(a0);
+			break;
+		case SYS_EXIT2:
+			EXIT_STATUS = (int32_t)a0;
+			RUN_FLAG = FALSE;
+			syscall_flush();
+			printf("Program exited with status %d\n", EXIT_STATUS);
+			break;
+		default:
+			/* older programs end with SYSCALL and no service number */
+			printf("Unknown syscall %d, stopping simulation\n", v0);
+			RUN_FLAG = FALSE;
+			break;
+	}
+}
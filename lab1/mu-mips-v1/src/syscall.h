@@ -0,0 +1,44 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* SPIM/MARS syscall services (service number in $v0)                        */
+/******************************************************************************/
+#define SYS_PRINT_INT    1
+#define SYS_PRINT_STRING 4
+#define SYS_READ_INT     5
+#define SYS_READ_STRING  8
+#define SYS_SBRK         9
+#define SYS_EXIT         10
+#define SYS_PRINT_CHAR   11
+#define SYS_READ_CHAR    12
+#define SYS_OPEN         13
+#define SYS_READ         14
+#define SYS_WRITE        15
+#define SYS_CLOSE        16
+#define SYS_EXIT2        17
+
+/* sbrk hands out the data region from here up to the stack reserve */
+#define HEAP_BEGIN       0x10040000
+#define STACK_RESERVE    0x01000000
+
+#define GUEST_MAX_FILES  32
+#define GUEST_STDOUT_BUF (1 << 20)
+#define GUEST_FILE_BUF   (1 << 16)
+#define GUEST_LINE_MAX   4096	/* longest line service 8 reads */
+
+extern uint32_t HEAP_BREAK;
+extern int EXIT_STATUS; /* a0 of exit2, 0 for exit */
+extern int SYSCALL_REPLAY;	/* re-running instructions already run once: no host file or stdin I/O */
+extern int REPLAY_STOPPED;	/* SYSCALL_REPLAY met a syscall it can't repeat and stopped the run */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+void syscall_reset();
+void syscall_flush();
+void handle_syscall();
+
+#endif
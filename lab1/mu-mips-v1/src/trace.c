@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mu-mips.h"
+#include "trace.h"
+#include "isa.h"
+
+int TRACE_ASYNC = FALSE;
+
+static struct {
+	char *data;
+	uint32_t len;
+	int full;	/* handed to the writer, not yet written */
+} BUFS[TRACE_BUFFERS];
+static int cur;	/* buffer the simulation thread fills */
+static int trace_fd = -1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t cond_free = PTHREAD_COND_INITIALIZER;
+
+/***************************************************************/
+/* Format one trace line, "[pc]\tMNEMONIC operands\n", the way  */
+/* handle_instruction() prints it; returns its length          */
+/***************************************************************/
+int trace_format(uint32_t pc, uint32_t instruction, char *line) {
+	char *p = line;
+
+	*p++ = '[';
+	p = isa_put_hex(p, pc, 1);
+	*p++ = ']';
+	*p++ = '\t';
+	p += isa_disassemble(instruction, p);
+	*p++ = '\n';
+	return p - line;
+}
+
+static void write_all(int fd, const char *buf, uint32_t len) {
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n <= 0) {
+			return;
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+/***************************************************************/
+/* Write the buffers out in the order they were filled         */
+/***************************************************************/
+static void *writer_thread(void *arg) {
+	int i = 0;
+
+	(void)arg;
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (!BUFS[i].full) {
+			pthread_cond_wait(&cond_full, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+		write_all(trace_fd, BUFS[i].data, BUFS[i].len);
+		pthread_mutex_lock(&lock);
+		BUFS[i].len = 0;
+		BUFS[i].full = FALSE;
+		pthread_cond_broadcast(&cond_free);
+		i = (i + 1) % TRACE_BUFFERS;
+	}
+	return NULL;
+}
+
+/***************************************************************/
+/* Send the trace to a file; call before any other thread runs */
+/***************************************************************/
+int trace_open(const char *path) {
+	pthread_t tid;
+	int i;
+
+	trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (trace_fd < 0) {
+		printf("Error: Can't open %s for writing\n", path);
+		return FALSE;
+	}
+	for (i = 0; i < TRACE_BUFFERS; i++) {
+		BUFS[i].data = malloc(TRACE_BUF_SIZE);
+		if (BUFS[i].data == NULL) {
+			printf("Error: can't allocate trace buffers\n");
+			return FALSE;
+		}
+	}
+	if (pthread_create(&tid, NULL, writer_thread, NULL) != 0) {
+		printf("Error: can't start the trace writer\n");
+		return FALSE;
+	}
+	pthread_detach(tid);
+	TRACE_ASYNC = TRUE;
+	return TRUE;
+}
+
+/***************************************************************/
+/* Pass the current buffer to the writer and move to the next; */
+/* only waits if the writer is a whole ring of buffers behind  */
+/***************************************************************/
+static void hand_off() {
+	pthread_mutex_lock(&lock);
+	BUFS[cur].full = TRUE;
+	pthread_cond_signal(&cond_full);
+	cur = (cur + 1) % TRACE_BUFFERS;
+	while (BUFS[cur].full) {
+		pthread_cond_wait(&cond_free, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/***************************************************************/
+/* Append one instruction to the file trace                    */
+/***************************************************************/
+void trace_instruction(uint32_t pc, uint32_t instruction) {
+	BUFS[cur].len += trace_format(pc, instruction, BUFS[cur].data + BUFS[cur].len);
+	if (BUFS[cur].len > TRACE_BUF_SIZE - TRACE_LINE_MAX) {
+		hand_off();
+	}
+}
+
+/***************************************************************/
+/* Hand over what is buffered; with wait, until it is written  */
+/***************************************************************/
+void trace_flush(int wait) {
+	int i;
+
+	if (!TRACE_ASYNC) {
+		return;
+	}
+	if (BUFS[cur].len > 0) {
+		hand_off();
+	}
+	if (!wait) {
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < TRACE_BUFFERS; i++) {
+		while (BUFS[i].full) {
+			pthread_cond_wait(&cond_free, &lock);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,23 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/******************************************************************************/
+/* Instruction trace: table-driven formatting and a background file writer    */
+/******************************************************************************/
+#define TRACE_LINE_MAX 64		/* longest line trace_format() produces */
+#define TRACE_BUFFERS  4
+#define TRACE_BUF_SIZE (1 << 20)
+
+extern int TRACE_ASYNC;	/* -t: trace goes to a file through the writer thread */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int trace_format(uint32_t pc, uint32_t instruction, char *line);
+int trace_open(const char *path);
+void trace_instruction(uint32_t pc, uint32_t instruction);
+void trace_flush(int wait);
+
+#endif
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "mu-mips.h"
+#include "syscall.h"
+#include "decode.h"
+#include "isa.h"
+#include "undo.h"
+#include "hang.h"
+
+#define KIND_REG 0	/* where: 0-31, REG_HI, REG_LO or UNDO_HEAP */
+#define KIND_MEM 1	/* where: word address */
+#define UNDO_HEAP NUM_DEP_REGS	/* the sbrk break */
+
+/* the log is a ring of words holding one record per instruction:
+   [len] [kind where old]... [pc] [len]
+   so it can be walked forward (to drop the oldest) and backward */
+#define AT(pos) LOG[(pos) % log_words]
+
+int UNDO_FLAG = FALSE;
+int UNDO_OPEN = FALSE;
+
+static uint32_t *LOG;
+static uint64_t log_words;
+static uint64_t head, tail;	/* oldest kept and next free position */
+static uint64_t rec_start;	/* start of the record being written */
+static uint32_t rec_pc;
+static int rec_overflow;
+static uint32_t records;	/* instructions that can be undone */
+
+static undo_checkpoint_t CHECKPOINTS[UNDO_MAX_CHECKPOINTS];
+static int cp_first, cp_count;
+static uint32_t since_checkpoint;
+
+#define CP_LAST CHECKPOINTS[(cp_first + cp_count - 1) % UNDO_MAX_CHECKPOINTS]
+
+/***************************************************************/
+/* Allocate a log of the given size in MiB and turn it on      */
+/***************************************************************/
+int undo_configure(const char *megabytes) {
+	int mb = atoi(megabytes);
+
+	if (mb < 1 || mb > 4096) {
+		printf("Error: undo log size must be 1..4096 MiB\n");
+		return FALSE;
+	}
+	log_words = (uint64_t)mb * 1024 * 1024 / sizeof(uint32_t);
+	LOG = malloc(log_words * sizeof(uint32_t));
+	if (LOG == NULL) {
+		printf("Error: can't allocate a %d MiB undo log\n", mb);
+		return FALSE;
+	}
+	UNDO_FLAG = TRUE;
+	undo_reset();
+	return TRUE;
+}
+
+/***************************************************************/
+/* Forget all history (on reset)                               */
+/***************************************************************/
+void undo_reset() {
+	head = tail = rec_start = 0;
+	records = 0;
+	cp_first = cp_count = 0;
+	since_checkpoint = 0;
+	UNDO_OPEN = FALSE;
+}
+
+/***************************************************************/
+/* Make room for n more words, dropping the oldest records;    */
+/* FALSE if the open record alone does not fit                 */
+/***************************************************************/
+static int reserve(uint32_t n) {
+	while (tail + n - head > log_words) {
+		if (head == rec_start) {
+			rec_overflow = TRUE;
+			return FALSE;
+		}
+		head += AT(head);
+		records--;
+		while (cp_count > 0 && CHECKPOINTS[cp_first].pos < head) {
+			cp_first = (cp_first + 1) % UNDO_MAX_CHECKPOINTS;
+			cp_count--;
+		}
+	}
+	return TRUE;
+}
+
+static void save_entry(uint32_t kind, uint32_t where, uint32_t old) {
+	if (rec_overflow || !reserve(3)) {
+		return;
+	}
+	AT(tail) = kind;
+	AT(tail + 1) = where;
+	AT(tail + 2) = old;
+	tail += 3;
+}
+
+static uint32_t *reg_slot(uint32_t reg) {
+	if (reg < MIPS_REGS) {
+		return &CURRENT_STATE.REGS[reg];
+	}
+	if (reg == REG_HI) {
+		return &CURRENT_STATE.HI;
+	}
+	if (reg == REG_LO) {
+		return &CURRENT_STATE.LO;
+	}
+	return &HEAP_BREAK;
+}
+
+/***************************************************************/
+/* Open the record for the instruction at PC and save the      */
+/* registers it is about to overwrite                          */
+/***************************************************************/
+void undo_begin() {
+	uint32_t instruction = mem_read_32(CURRENT_STATE.PC);
+	inst_deps_t deps;
+	int i;
+
+	if (since_checkpoint == 0 && (cp_count == 0 || CP_LAST.pos != tail)) {
+		if (cp_count == UNDO_MAX_CHECKPOINTS) {
+			cp_first = (cp_first + 1) % UNDO_MAX_CHECKPOINTS;
+			cp_count--;
+		}
+		cp_count++;
+		CP_LAST.state = CURRENT_STATE;
+		CP_LAST.count = INSTRUCTION_COUNT;
+		CP_LAST.heap_break = HEAP_BREAK;
+		CP_LAST.pos = tail;
+	}
+	since_checkpoint = (since_checkpoint + 1) % UNDO_CHECKPOINT_INTERVAL;
+
+	rec_start = tail;
+	rec_pc = CURRENT_STATE.PC;
+	rec_overflow = FALSE;
+	if (!reserve(1)) {
+		return;
+	}
+	AT(tail++) = 0;	/* length, patched by undo_end() */
+	UNDO_OPEN = TRUE;
+
+	decode_deps(instruction, &deps);
+	for (i = 0; i < 2; i++) {
+		if (deps.dst[i] != REG_NONE) {
+			save_entry(KIND_REG, deps.dst[i], *reg_slot(deps.dst[i]));
+		}
+	}
+	if (isa_decode(instruction) == ISA_SYSCALL && CURRENT_STATE.REGS[2] == SYS_SBRK) {
+		save_entry(KIND_REG, UNDO_HEAP, HEAP_BREAK);
+	}
+}
+
+/***************************************************************/
+/* Save the words under [address, address+count) before a      */
+/* store overwrites them                                       */
+/***************************************************************/
+void undo_save_range(uint32_t address, uint32_t count) {
+	uint64_t a, end = (uint64_t)address + count;
+	uint32_t avail;
+	uint8_t *p;
+
+	for (a = address & ~3u; a < end; a += 4) {
+		p = mem_host_ptr((uint32_t)a, &avail);
+		if (p != NULL && avail >= 4) {
+			save_entry(KIND_MEM, (uint32_t)a, p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+		}
+	}
+}
+
+/***************************************************************/
+/* Close the record of the instruction that just executed      */
+/***************************************************************/
+void undo_end() {
+	uint32_t len;
+
+	UNDO_OPEN = FALSE;
+	if (!rec_overflow && reserve(2)) {
+		AT(tail) = rec_pc;
+		len = (uint32_t)(tail + 2 - rec_start);
+		AT(tail + 1) = len;
+		tail += 2;
+		AT(rec_start) = len;
+		records++;
+		return;
+	}
+	/* one instruction wrote more than the whole log holds */
+	head = tail = rec_start;
+	records = 0;
+	cp_count = 0;
+}
+
+/***************************************************************/
+/* Roll back the newest record; registers only if full         */
+/***************************************************************/
+static void undo_record(int full) {
+	uint32_t len = AT(tail - 1), pc = AT(tail - 2);
+	uint64_t start = tail - len, p;
+	uint32_t kind, where, old, avail;
+	uint8_t *host;
+	int i;
+
+	/* newest entry first, so a word saved twice ends up with its oldest value */
+	for (i = (len - 3) / 3 - 1; i >= 0; i--) {
+		p = start + 1 + 3 * (uint64_t)i;
+		kind = AT(p);
+		where = AT(p + 1);
+		old = AT(p + 2);
+		if (kind == KIND_MEM) {
+			host = mem_host_ptr(where, &avail);
+			if (host == NULL || avail < 4) {
+				continue;
+			}
+			host[0] = old & 0xFF;
+			host[1] = (old >> 8) & 0xFF;
+			host[2] = (old >> 16) & 0xFF;
+			host[3] = (old >> 24) & 0xFF;
+		} else if (full) {
+			*reg_slot(where) = old;
+		}
+	}
+	if (full) {
+		CURRENT_STATE.PC = pc;
+	}
+	tail = start;
+	records--;
+	INSTRUCTION_COUNT--;
+}
+
+/***************************************************************/
+/* Common tail of the backward commands                        */
+/***************************************************************/
+static void finish_back(uint32_t stepped) {
+	while (cp_count > 0 && CP_LAST.pos > tail) {
+		cp_count--;
+	}
+	since_checkpoint = cp_count > 0 ? (INSTRUCTION_COUNT - CP_LAST.count) % UNDO_CHECKPOINT_INTERVAL : 0;
+	NEXT_STATE = CURRENT_STATE;
+	if (HANG_FLAG) {
+		hang_forget();	/* the states ahead will be met again */
+	}
+	if (stepped > 0) {
+		RUN_FLAG = TRUE;
+	}
+	printf("Stepped back %u instructions to PC 0x%08x (%u instructions of history left)\n\n",
+		stepped, CURRENT_STATE.PC, records);
+}
+
+/***************************************************************/
+/* Move n instructions back in time                            */
+/***************************************************************/
+void undo_step_back(uint32_t n) {
+	uint32_t target;
+	int i, best = -1;
+	undo_checkpoint_t *cp;
+
+	if (n > records) {
+		n = records;
+	}
+	target = INSTRUCTION_COUNT - n;
+
+	/* jump to the oldest checkpoint at or after the target: the records
+	   in between only need their memory words put back */
+	for (i = 0; i < cp_count; i++) {
+		cp = &CHECKPOINTS[(cp_first + i) % UNDO_MAX_CHECKPOINTS];
+		if (cp->count >= target && cp->count < INSTRUCTION_COUNT && cp->pos >= head) {
+			best = (cp_first + i) % UNDO_MAX_CHECKPOINTS;
+			break;
+		}
+	}
+	if (best >= 0) {
+		while (tail > CHECKPOINTS[best].pos) {
+			undo_record(FALSE);
+		}
+		CURRENT_STATE = CHECKPOINTS[best].state;
+		HEAP_BREAK = CHECKPOINTS[best].heap_break;
+	}
+	while (INSTRUCTION_COUNT > target) {
+		undo_record(TRUE);
+	}
+	finish_back(n);
+}
+
+/***************************************************************/
+/* Run backward until PC reaches target_pc, or to the oldest   */
+/* retained instruction                                        */
+/***************************************************************/
+void undo_continue_back(int have_target, uint32_t target_pc) {
+	uint32_t stepped = 0;
+
+	if (!have_target) {
+		undo_step_back(records);
+		return;
+	}
+	while (records > 0) {
+		undo_record(TRUE);
+		stepped++;
+		if (CURRENT_STATE.PC == target_pc) {
+			break;
+		}
+	}
+	if (CURRENT_STATE.PC != target_pc) {
+		printf("0x%08x not reached in the retained history\n", target_pc);
+	}
+	finish_back(stepped);
+}
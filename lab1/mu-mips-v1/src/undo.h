@@ -0,0 +1,35 @@
+#ifndef UNDO_H
+#define UNDO_H
+
+#include <stdint.h>
+#include "mu-mips.h"
+
+/******************************************************************************/
+/* Undo log for stepping the simulation backward                             */
+/******************************************************************************/
+#define UNDO_CHECKPOINT_INTERVAL 4096	/* instructions between CPU state checkpoints */
+#define UNDO_MAX_CHECKPOINTS     256
+#define UNDO_DEFAULT_MB          16
+
+typedef struct {
+	CPU_State state;	/* before the instruction at log position pos ran */
+	uint32_t count;		/* INSTRUCTION_COUNT at that point */
+	uint32_t heap_break;
+	uint64_t pos;
+} undo_checkpoint_t;
+
+extern int UNDO_FLAG;	/* -u: keep an undo log while running */
+extern int UNDO_OPEN;	/* an instruction is executing, so stores are logged */
+
+/***************************************************************/
+/* Function Declerations.                                      */
+/***************************************************************/
+int undo_configure(const char *megabytes);
+void undo_reset();
+void undo_begin();
+void undo_end();
+void undo_save_range(uint32_t address, uint32_t count);
+void undo_step_back(uint32_t n);
+void undo_continue_back(int have_target, uint32_t target_pc);
+
+#endif